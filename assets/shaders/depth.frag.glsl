@@ -0,0 +1,7 @@
+// #version and precision are added by the shader variant generator
+
+// depth pre-pass: only depth is written, there's nothing to shade
+
+void main()
+{
+}
@@ -0,0 +1,10 @@
+// #version and precision are added by the shader variant generator
+
+layout (location=0) uniform vec4 color;
+
+layout (location=0) out vec4 o_color;
+
+void main()
+{
+    o_color = color;
+}
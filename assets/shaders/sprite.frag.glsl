@@ -1,5 +1,4 @@
-#version 300 es
-precision mediump float;
+// #version and precision are added by the shader variant generator
 
 in vec2 v_uv;
 in vec4 v_color;
@@ -14,5 +13,4 @@ void main()
 
     // Mom: we have sRGB at home:
     o_color = pow(col, vec4(1.f / 2.2f));
-} 
-
+}
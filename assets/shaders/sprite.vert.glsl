@@ -1,19 +1,52 @@
-#version 300 es
-precision mediump float;
+// #version and precision are added by the shader variant generator
 
-layout(location=0) in vec3 a_position; 
-layout(location=1) in vec2 a_uv; 
-layout(location=2) in vec4 a_color; 
+layout(location=0) in vec3 a_position;
+layout(location=1) in vec2 a_uv;
+#ifdef SKINNED
+layout(location=4) in uvec4 a_joints;
+layout(location=5) in vec4 a_weights;
+#else
+layout(location=2) in vec4 a_color;
+#endif
 
-out vec2 v_uv;   
-out vec4 v_color;   
+out vec2 v_uv;
+out vec4 v_color;
 
-layout (location = 0) uniform mat4 vp;
-layout (location = 1) uniform mat4 model;
+// the depth pre-pass uses this shader too, its depth has to match exactly
+invariant gl_Position;
 
-void main()       
+// blocks and their binding points are in src/Graphics/ShaderUniforms.h
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 proj;
+    mat4 vp;
+    vec4 time;
+};
+
+layout (std140) uniform Object {
+    mat4 model;
+};
+
+#ifdef SKINNED
+// MAX_JOINTS comes from Graphics/ShaderUniforms.h
+layout (std140) uniform Skin {
+    mat4 jointMatrices[MAX_JOINTS];
+};
+#endif
+
+void main()
 {
+#ifdef SKINNED
+    mat4 skin =
+        a_weights.x * jointMatrices[a_joints.x] +
+        a_weights.y * jointMatrices[a_joints.y] +
+        a_weights.z * jointMatrices[a_joints.z] +
+        a_weights.w * jointMatrices[a_joints.w];
+    gl_Position = vp * model * skin * vec4(a_position, 1.0);
+    v_color = vec4(1.0);
+#else
     gl_Position = vp * model * vec4(a_position, 1.0);
-    v_uv = a_uv;
     v_color = a_color;
+#endif
+    v_uv = a_uv;
 }
@@ -0,0 +1,28 @@
+// #version and precision are added by the shader variant generator
+
+// mediump isn't precise enough for texel coordinates
+in highp vec2 v_uv;
+
+layout (location=0) uniform sampler2D tex;
+// the scene can only occupy a part of the texture
+layout (location=1) uniform highp vec2 sourceSize;
+layout (location=2) uniform highp vec2 textureSize;
+// output pixels per source texel
+layout (location=3) uniform highp vec2 scale;
+
+layout (location=0) out vec4 o_color;
+
+void main()
+{
+    highp vec2 texel = v_uv * sourceSize;
+#ifdef SHARP_BILINEAR
+    // sample the texel center everywhere except for a one output pixel wide
+    // border where bilinear filtering blends it with the neighbour
+    highp vec2 region = max(0.5 - 0.5 / scale, 0.0);
+    highp vec2 d = fract(texel) - 0.5;
+    highp vec2 f = (d - clamp(d, -region, region)) * scale + 0.5;
+    texel = clamp(floor(texel) + f, vec2(0.5), sourceSize - 0.5);
+#endif
+    // the sprite shader has already applied gamma
+    o_color = texture(tex, texel / textureSize);
+}
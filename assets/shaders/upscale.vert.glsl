@@ -0,0 +1,11 @@
+// #version and precision are added by the shader variant generator
+
+out vec2 v_uv;
+
+void main()
+{
+    // fullscreen triangle, no vertex buffers needed
+    vec2 pos = vec2(float((gl_VertexID & 1) << 2), float((gl_VertexID & 2) << 1)) - 1.0;
+    v_uv = pos * 0.5 + 0.5;
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
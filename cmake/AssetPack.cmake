@@ -0,0 +1,30 @@
+# Packs assets_dir into a single file at pack_path (see src/util/AssetPackFormat.h).
+# Entry names are prefixed with "assets/" so that the game can use the same paths
+# for packed and loose files.
+#
+# Files listed in STREAMED (relative to assets_dir) are written to STREAM_DIR
+# instead of the pack, so that they can be loaded by util::AssetStreamer later.
+function(add_asset_pack target_name assets_dir pack_path)
+  cmake_parse_arguments(PARSE_ARGV 3 arg "" "STREAM_DIR" "STREAMED")
+  include(HostTools)
+  get_host_tool(asset_packer asset_packer)
+
+  file(GLOB_RECURSE asset_files CONFIGURE_DEPENDS "${assets_dir}/*")
+
+  set(stream_args "")
+  set(streamed_outputs "")
+  if(arg_STREAMED)
+    set(stream_args --stream-dir "${arg_STREAM_DIR}" ${arg_STREAMED})
+    list(TRANSFORM arg_STREAMED PREPEND "${arg_STREAM_DIR}/" OUTPUT_VARIABLE streamed_outputs)
+  endif()
+
+  add_custom_command(
+    OUTPUT "${pack_path}" ${streamed_outputs}
+    COMMAND ${asset_packer} "${pack_path}" "${assets_dir}" assets ${stream_args}
+    DEPENDS ${asset_files} ${asset_packer_DEPENDS}
+    COMMENT "Packing game assets"
+  )
+
+  add_custom_target(${target_name}_asset_pack DEPENDS "${pack_path}")
+  add_dependencies(${target_name} ${target_name}_asset_pack)
+endfunction()
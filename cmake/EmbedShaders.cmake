@@ -0,0 +1,56 @@
+# Shader variants are built from a single GLSL source + a set of #defines.
+# All variants get resolved at build time into a generated header with
+# embedded source strings, so nothing has to be read/assembled on startup.
+# Integer constants from CONSTANTS (a C++ header with `inline constexpr std::size_t NAME = N;`
+# lines) are added to every variant as #defines, so that shaders and C++ share them.
+#
+#   add_shader_variant(game skinned VERTEX sprite.vert.glsl FRAGMENT sprite.frag.glsl DEFINES SKINNED)
+#   embed_shaders(game "${assets_dir}/shaders" CONSTANTS Graphics/ShaderUniforms.h)
+
+function (add_shader_variant target_name variant_name)
+  cmake_parse_arguments(PARSE_ARGV 2 arg "" "VERTEX;FRAGMENT" "DEFINES")
+  string(REPLACE ";" "," defines "${arg_DEFINES}")
+  set_property(TARGET ${target_name} APPEND PROPERTY SHADER_VARIANTS
+    "${variant_name}:${arg_VERTEX}:${arg_FRAGMENT}:${defines}"
+  )
+endfunction()
+
+function (embed_shaders target_name shader_dir)
+  cmake_parse_arguments(PARSE_ARGV 2 arg "" "CONSTANTS" "")
+  if (arg_CONSTANTS)
+    get_filename_component(constants_header "${arg_CONSTANTS}" ABSOLUTE)
+  endif()
+
+  get_target_property(variants ${target_name} SHADER_VARIANTS)
+  # ";" can't be passed through COMMAND safely
+  string(REPLACE ";" "%" variants_arg "${variants}")
+
+  set(generated_dir "${CMAKE_CURRENT_BINARY_DIR}/generated")
+  set(output "${generated_dir}/EmbeddedShaders.h")
+
+  if (EMSCRIPTEN)
+    set(glsl_es ON)
+  else()
+    set(glsl_es OFF)
+  endif()
+
+  file(GLOB shader_sources CONFIGURE_DEPENDS "${shader_dir}/*.glsl")
+  set(script "${PROJECT_SOURCE_DIR}/cmake/EmbedShadersScript.cmake")
+
+  add_custom_command(
+    OUTPUT "${output}"
+    COMMAND ${CMAKE_COMMAND}
+      "-DVARIANTS=${variants_arg}"
+      "-DSHADER_DIR=${shader_dir}"
+      "-DOUTPUT=${output}"
+      "-DGLSL_ES=${glsl_es}"
+      "-DCONSTANTS_HEADER=${constants_header}"
+      -P "${script}"
+    DEPENDS "${script}" ${shader_sources} ${constants_header}
+    COMMENT "Embedding shader variants"
+    VERBATIM
+  )
+
+  target_sources(${target_name} PRIVATE "${output}")
+  target_include_directories(${target_name} PRIVATE "${generated_dir}")
+endfunction()
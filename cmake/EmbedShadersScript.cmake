@@ -0,0 +1,82 @@
+# Invoked by embed_shaders (see EmbedShaders.cmake) in script mode:
+#   cmake -DVARIANTS=... -DSHADER_DIR=... -DOUTPUT=... -DGLSL_ES=ON|OFF [-DCONSTANTS_HEADER=...]
+#     -P EmbedShadersScript.cmake
+
+cmake_policy(SET CMP0007 NEW) # keep empty list elements (variants without defines)
+
+if (GLSL_ES)
+  set(vertex_header "#version 300 es\nprecision highp float;\n")
+  set(fragment_header "#version 300 es\nprecision mediump float;\n")
+else()
+  set(vertex_header "#version 330 core\n#extension GL_ARB_explicit_uniform_location: enable\n")
+  set(fragment_header "${vertex_header}")
+endif()
+
+# constants shared with C++, e.g. `inline constexpr std::size_t MAX_JOINTS = 64;`
+if (CONSTANTS_HEADER)
+  set(constant_regex "inline constexpr std::size_t ([A-Z_0-9]+) = ([0-9]+);")
+  file(STRINGS "${CONSTANTS_HEADER}" constant_lines REGEX "${constant_regex}")
+  if (NOT constant_lines)
+    message(FATAL_ERROR "No shader constants found in ${CONSTANTS_HEADER}")
+  endif()
+  foreach(line IN LISTS constant_lines)
+    string(REGEX MATCH "${constant_regex}" _ "${line}")
+    string(APPEND vertex_header "#define ${CMAKE_MATCH_1} ${CMAKE_MATCH_2}\n")
+    string(APPEND fragment_header "#define ${CMAKE_MATCH_1} ${CMAKE_MATCH_2}\n")
+  endforeach()
+endif()
+
+set(content "// Generated by cmake/EmbedShadersScript.cmake - do not edit\n")
+string(APPEND content "#pragma once\n\n#include <Graphics/Shader.h>\n\nnamespace shaders\n{\n")
+
+string(REPLACE "%" ";" variants "${VARIANTS}")
+set(variant_names "")
+foreach(variant IN LISTS variants)
+  string(REPLACE ":" ";" parts "${variant}")
+  list(GET parts 0 name)
+  list(GET parts 1 vertex_file)
+  list(GET parts 2 fragment_file)
+  list(LENGTH parts num_parts)
+  set(defines "")
+  if (num_parts GREATER 3)
+    list(GET parts 3 defines_list)
+    string(REPLACE "," ";" defines_list "${defines_list}")
+    foreach(define IN LISTS defines_list)
+      string(APPEND defines "#define ${define}\n")
+    endforeach()
+  endif()
+
+  file(READ "${SHADER_DIR}/${vertex_file}" vertex_source)
+  file(READ "${SHADER_DIR}/${fragment_file}" fragment_source)
+
+  set(vertex_prefix "${vertex_header}${defines}")
+  set(fragment_prefix "${fragment_header}${defines}")
+
+  string(SHA256 hash "${vertex_prefix}${vertex_source}${fragment_prefix}${fragment_source}")
+  string(SUBSTRING "${hash}" 0 16 hash)
+
+  string(APPEND content "inline constexpr EmbeddedShader ${name}{\n")
+  string(APPEND content "    .name = \"${name}\",\n")
+  string(APPEND content "    .vertexFile = \"${vertex_file}\",\n")
+  string(APPEND content "    .fragmentFile = \"${fragment_file}\",\n")
+  string(APPEND content "    .vertexPrefix = R\"glsl(${vertex_prefix})glsl\",\n")
+  string(APPEND content "    .fragmentPrefix = R\"glsl(${fragment_prefix})glsl\",\n")
+  string(APPEND content "    .vertexSource = R\"glsl(${vertex_prefix}${vertex_source})glsl\",\n")
+  string(APPEND content "    .fragmentSource = R\"glsl(${fragment_prefix}${fragment_source})glsl\",\n")
+  string(APPEND content "    .sourceHash = \"${hash}\",\n")
+  string(APPEND content "};\n\n")
+  list(APPEND variant_names "&${name}")
+endforeach()
+
+list(JOIN variant_names ", " variant_list)
+string(APPEND content "inline constexpr const EmbeddedShader* allVariants[] = {${variant_list}};\n")
+string(APPEND content "}\n")
+
+# don't touch the file if nothing changed to avoid needless recompilation
+set(old_content "")
+if (EXISTS "${OUTPUT}")
+  file(READ "${OUTPUT}" old_content)
+endif()
+if (NOT old_content STREQUAL content)
+  file(WRITE "${OUTPUT}" "${content}")
+endif()
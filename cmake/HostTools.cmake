@@ -0,0 +1,38 @@
+# Tools from tools/ run on the build machine. Web builds can't build them with the
+# emscripten toolchain, so there they're built for the host via ExternalProject.
+set(HOST_TOOLS asset_packer wasm_size_report)
+
+# Sets <out_var> to the tool's executable, <out_var>_TARGET to the target which
+# builds it and <out_var>_DEPENDS to what custom commands which run it should depend on.
+function(get_host_tool tool_name out_var)
+  if(EMSCRIPTEN)
+    set(host_tools_dir "${CMAKE_BINARY_DIR}/host_tools")
+    if(CMAKE_HOST_WIN32)
+      set(suffix ".exe")
+    endif()
+
+    if(NOT TARGET host_tools)
+      list(TRANSFORM HOST_TOOLS PREPEND "${host_tools_dir}/" OUTPUT_VARIABLE byproducts)
+      list(TRANSFORM byproducts APPEND "${suffix}")
+
+      include(ExternalProject)
+      ExternalProject_Add(host_tools
+        SOURCE_DIR "${PROJECT_SOURCE_DIR}/tools"
+        BINARY_DIR "${host_tools_dir}"
+        CMAKE_ARGS -DCMAKE_BUILD_TYPE=Release
+        INSTALL_COMMAND ""
+        BUILD_ALWAYS ON
+        BUILD_BYPRODUCTS ${byproducts}
+      )
+    endif()
+
+    set(tool "${host_tools_dir}/${tool_name}${suffix}")
+    set(${out_var} "${tool}" PARENT_SCOPE)
+    set(${out_var}_TARGET host_tools PARENT_SCOPE)
+    set(${out_var}_DEPENDS host_tools "${tool}" PARENT_SCOPE)
+  else()
+    set(${out_var} $<TARGET_FILE:${tool_name}> PARENT_SCOPE)
+    set(${out_var}_TARGET ${tool_name} PARENT_SCOPE)
+    set(${out_var}_DEPENDS ${tool_name} PARENT_SCOPE)
+  endif()
+endfunction()
@@ -11,4 +11,7 @@ function (add_itch_io_publish_target target_name itch_path)
     USES_TERMINAL
   )
   add_dependencies(itch_push_${target_name} ${target_name})
+  if (TARGET web_bundle_${target_name})
+    add_dependencies(itch_push_${target_name} web_bundle_${target_name})
+  endif()
 endfunction()
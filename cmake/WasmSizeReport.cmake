@@ -0,0 +1,27 @@
+# Prints wasm section sizes and code size per module (SDL, ImGui, libc++, ...)
+# after each link. The binary is linked with function names which are stripped
+# by wasm-opt once the report is done.
+function(add_wasm_size_report target_name)
+  include(HostTools)
+  get_host_tool(wasm_size_report wasm_size_report)
+  add_dependencies(${target_name} ${wasm_size_report_TARGET})
+
+  # emsdk puts binaryen next to emscripten
+  find_program(WASM_OPT wasm-opt HINTS "${EMSCRIPTEN_ROOT_PATH}/../bin")
+
+  set(wasm_file "$<TARGET_FILE_DIR:${target_name}>/$<TARGET_FILE_BASE_NAME:${target_name}>.wasm")
+  if(WASM_OPT)
+    target_link_options(${target_name} PRIVATE "--profiling-funcs")
+    add_custom_command(TARGET ${target_name} POST_BUILD
+      COMMAND ${wasm_size_report} "${wasm_file}"
+      COMMAND ${WASM_OPT} --strip-debug --strip-producers "${wasm_file}" -o "${wasm_file}"
+      COMMENT "Reporting and stripping ${target_name}.wasm"
+    )
+  else()
+    message(WARNING "wasm-opt wasn't found, the size report won't have function names")
+    add_custom_command(TARGET ${target_name} POST_BUILD
+      COMMAND ${wasm_size_report} "${wasm_file}"
+      COMMENT "Reporting ${target_name}.wasm size"
+    )
+  endif()
+endfunction()
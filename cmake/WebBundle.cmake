@@ -1,9 +1,42 @@
+# Copies the page into the site dir. In single-threaded web builds the threaded
+# variant (see WEB_THREADS) is also built and put next to it, the page picks one of them.
+option(WEB_THREADS_VARIANT "Web: also build the threaded variant" ON)
+
 function (add_web_bundle_target target_name)
-  set(index_page_path "${PROJECT_SOURCE_DIR}/html/index.html")
+  set(html_dir "${PROJECT_SOURCE_DIR}/html")
   set(web_output_dir "${CMAKE_CURRENT_BINARY_DIR}/site")
 
   add_custom_target(web_bundle_${target_name} ALL
     COMMENT "Bundling website dir"
-    COMMAND ${CMAKE_COMMAND} -E copy "${index_page_path}" "${web_output_dir}"
+    COMMAND ${CMAKE_COMMAND} -E copy
+      "${html_dir}/index.html"
+      "${html_dir}/coi-serviceworker.js"
+      "${web_output_dir}"
   )
+  add_dependencies(web_bundle_${target_name} ${target_name})
+
+  if (WEB_THREADS_VARIANT AND NOT WEB_THREADS)
+    set(variant_dir "${CMAKE_BINARY_DIR}/web_threads")
+
+    include(ExternalProject)
+    ExternalProject_Add(${target_name}_threads
+      SOURCE_DIR "${PROJECT_SOURCE_DIR}"
+      BINARY_DIR "${variant_dir}"
+      CMAKE_ARGS
+        -DCMAKE_TOOLCHAIN_FILE=${CMAKE_TOOLCHAIN_FILE}
+        -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE}
+        -DWEB_THREADS=ON
+        -DSHIPPING_BUILD=${SHIPPING_BUILD}
+        -DUSE_ASSET_PACK=${USE_ASSET_PACK}
+      BUILD_COMMAND ${CMAKE_COMMAND} --build "${variant_dir}" --target ${target_name}
+      INSTALL_COMMAND ""
+      BUILD_ALWAYS ON
+    )
+
+    # only the game-mt.* files and streamed assets (the same as ours) are in there
+    add_custom_command(TARGET web_bundle_${target_name} POST_BUILD
+      COMMAND ${CMAKE_COMMAND} -E copy_directory "${variant_dir}/src/site" "${web_output_dir}"
+    )
+    add_dependencies(web_bundle_${target_name} ${target_name}_threads)
+  endif()
 endfunction()
@@ -0,0 +1,32 @@
+// Adds cross-origin isolation headers to every response so that SharedArrayBuffer
+// (and the threaded build) works on hosts where they can't be configured.
+
+self.addEventListener('install', function() {
+    self.skipWaiting();
+});
+
+self.addEventListener('activate', function(event) {
+    event.waitUntil(self.clients.claim());
+});
+
+self.addEventListener('fetch', function(event) {
+    var request = event.request;
+    if (request.cache === 'only-if-cached' && request.mode !== 'same-origin') {
+        return;
+    }
+
+    event.respondWith(fetch(request).then(function(response) {
+        if (response.status === 0) { // opaque, headers can't be changed
+            return response;
+        }
+
+        var headers = new Headers(response.headers);
+        headers.set('Cross-Origin-Embedder-Policy', 'require-corp');
+        headers.set('Cross-Origin-Opener-Policy', 'same-origin');
+        return new Response(response.body, {
+            status: response.status,
+            statusText: response.statusText,
+            headers: headers
+        });
+    }));
+});
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// Components of entities stored in util::EntityRegistry
+
+struct Transform {
+    glm::vec3 position;
+    float rotationAngle; // around the Y axis
+    glm::mat4 world; // has to be updated when position or rotationAngle change
+};
+
+// rotates the entity around the Y axis
+struct Spin {
+    float speed; // radians per second
+};
+
+struct Renderable {
+    std::uint32_t mesh; // index in the model's meshes
+    bool visible; // set by frustum and occlusion culling each frame
+};
+
+struct AnimationState {
+    float time; // in the first animation of the model
+};
@@ -2,30 +2,35 @@
 #include "SDL_video.h"
 #include "glm/ext/matrix_transform.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
-#include <fstream>
-#include <iostream>
-#include <sstream>
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #include <emscripten/html5.h>
 #endif
 
+#include <Components.h>
+#include <EmbeddedShaders.h>
+#include <Graphics/BVH.h>
+#include <Graphics/Frustum.h>
 #include <Graphics/Model.h>
-#include <util/GLUtil.h>
-#include <util/GltfLoader.h>
+#include <Graphics/Shader.h>
+#include <Graphics/ShaderUniforms.h>
+#include <util/ModelLoader.h>
 #include <util/ImageLoader.h>
+#include <util/Log.h>
 #include <util/OSUtil.h>
+#include <util/VirtualFS.h>
 
 #include <Platform/gl.h>
 
-#include <glm/gtc/type_ptr.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
 
 #include <imgui.h>
 #include <imgui_impl_opengl3.h>
@@ -33,56 +38,9 @@
 
 namespace
 {
-std::string readFileIntoString(const std::filesystem::path& path)
-{
-    // open file
-    std::ifstream f;
-    f.open(path, std::ios::in | std::ios::binary);
-    if (!f.good()) {
-        std::cerr << "Failed to open file from " << path << " (file not found?)" << std::endl;
-        assert(false);
-    }
-
-    // read whole file into string buffer
-    std::stringstream buffer;
-    buffer << f.rdbuf();
-    return buffer.str();
-}
-
-std::uint32_t loadShader(const char* vertexSource, const char* fragmentSource)
-{
-    // vertex
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexSource, NULL);
-    glCompileShader(vertexShader);
-    bool ok = util::printShaderCompilationErrors(vertexShader, vertexSource);
-    assert(ok);
-
-    // fragment
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-    glCompileShader(fragmentShader);
-    ok = util::printShaderCompilationErrors(fragmentShader, fragmentSource);
-    assert(ok);
-
-    // link
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // check linking status
-    ok = util::printShaderLinkErrors(shaderProgram);
-    assert(ok);
-
-    // detach and clean-up
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    return shaderProgram;
-}
+const std::filesystem::path SHADER_CACHE_DIR{"shader_cache"};
+const std::filesystem::path ASSET_PACK_PATH{"assets.pack"};
+const std::filesystem::path MODEL_PATH{"assets/models/yae.gltf"};
 
 void shaderBindSampler(
     std::uint32_t shaderProgram,
@@ -101,57 +59,83 @@ void shaderBindSampler(
     glBindTexture(GL_TEXTURE_2D, texture);
 }
 
-void shaderSetUniformMatrix(
+void shaderSetUniformVec2(
     std::uint32_t shaderProgram,
     const char* uniformName,
     GLuint uniformLoc,
-    const glm::mat4& m)
+    const glm::vec2& v)
 {
     auto loc = glGetUniformLocation(shaderProgram, uniformName);
     assert(loc == uniformLoc);
 
-    glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(m));
+    glUniform2f(loc, v.x, v.y);
 }
 
-std::uint32_t loadTexture(const char* path, bool flipped = true)
+void shaderSetUniformVec4(
+    std::uint32_t shaderProgram,
+    const char* uniformName,
+    GLuint uniformLoc,
+    const glm::vec4& v)
 {
-    const auto imageData = util::loadImage(path, flipped);
-    if (!imageData.pixels) {
-        printf("Failed to load image '%s'\n", path);
+    auto loc = glGetUniformLocation(shaderProgram, uniformName);
+    assert(loc == uniformLoc);
+
+    glUniform4f(loc, v.x, v.y, v.z, v.w);
+}
+
+void setDepthRange(float nearVal, float farVal)
+{
+#ifdef __EMSCRIPTEN__
+    glDepthRangef(nearVal, farVal);
+#else
+    glDepthRange(nearVal, farVal);
+#endif
+}
+
+GLTexture loadTexture(const char* path, bool flipped = true)
+{
+    const auto imageData = util::loadImage(path, {.flip = flipped});
+    if (!imageData.pixels && !imageData.hdrPixels) {
+        LOG_ERROR("Failed to load image '%s'", path);
         assert(false);
     }
     assert(imageData.channels == 4);
 
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    auto texture = GLTexture::create();
+    glBindTexture(GL_TEXTURE_2D, texture.get());
 
     glTexImage2D(
         GL_TEXTURE_2D, // target
         0, // no mipmap
-        GL_SRGB8_ALPHA8, // internalformat
+        imageData.hdr ? GL_RGBA16F : GL_SRGB8_ALPHA8, // internalformat
         imageData.width, // width
         imageData.height, // height
         0, // border
         GL_RGBA, // format
-        GL_UNSIGNED_BYTE, // type
-        imageData.pixels // pixels
+        imageData.hdr ? GL_FLOAT : GL_UNSIGNED_BYTE, // type
+        imageData.hdr ? static_cast<const void*>(imageData.hdrPixels) : imageData.pixels // pixels
     );
 
     return texture;
 }
 
+glm::mat4 makeWorldTransform(const glm::vec3& position, float rotationAngle)
+{
+    return glm::rotate(
+        glm::translate(glm::mat4{1.f}, position), rotationAngle, glm::vec3{0.f, 1.f, 0.f});
+}
+
 }
 
 void Game::initGeometry()
 {
     // vao
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    vao = GLVertexArray::create();
+    glBindVertexArray(vao.get());
 
     // vbo
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    vbo = GLBuffer::create();
+    glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
 
     struct Vertex {
         float pos[3];
@@ -184,8 +168,8 @@ void Game::initGeometry()
 
     // ebo
     GLushort indices[] = {0, 1, 2, 2, 3, 0};
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    ebo = GLBuffer::create();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo.get());
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     // specify vertex layout
@@ -200,15 +184,22 @@ void Game::initGeometry()
     glEnableVertexAttribArray(2);
 }
 
-void Game::start()
+void Game::start(const Params& params)
 {
 #ifndef __EMSCRIPTEN__
+    useRenderThread = params.renderThread;
     util::setCurrentDirToExeDir();
 #endif
+    // without a pack (e.g. during development) assets are read from assets/ directly
+    if (std::filesystem::exists(ASSET_PACK_PATH)) {
+        util::mountAssetPack(ASSET_PACK_PATH);
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+        LOG_ERROR("SDL could not initialize! SDL_Error: %s", SDL_GetError());
         std::exit(1);
     }
+    inputQueue.start();
 
     window = SDL_CreateWindow(
         "SDL Test",
@@ -221,7 +212,7 @@ void Game::start()
     screenHeight = renderHeight;
 
     if (!window) {
-        printf("Window could not be created! SDL_Error: %s\n", SDL_GetError());
+        LOG_ERROR("Window could not be created! SDL_Error: %s", SDL_GetError());
         std::exit(1);
     }
 
@@ -243,7 +234,7 @@ void Game::start()
     // Initialize GLAD
     int gl_version = gladLoaderLoadGL();
     if (!gl_version) {
-        printf("Unable to load GL.\n");
+        LOG_ERROR("Unable to load GL.");
         std::exit(1);
     }
 #endif
@@ -267,29 +258,65 @@ void Game::start()
 
     texture = loadTexture("assets/textures/shinji.png");
 
-    glGenSamplers(1, &sampler);
-    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-#ifdef __EMSCRIPTEN__
-    const auto vertexSource = readFileIntoString("assets/shaders/sprite.vert.glsl");
-    const auto fragmentSource = readFileIntoString("assets/shaders/sprite.frag.glsl");
-#else
-    const auto vertexSource = readFileIntoString("assets/shaders/sprite_desktop.vert.glsl");
-    const auto fragmentSource = readFileIntoString("assets/shaders/sprite_desktop.frag.glsl");
+    sampler = GLSampler::create();
+    glSamplerParameteri(sampler.get(), GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glSamplerParameteri(sampler.get(), GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glSamplerParameteri(sampler.get(), GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(sampler.get(), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    shaderProgram = util::loadShaderProgram(shaders::sprite, SHADER_CACHE_DIR);
+    assert(shaderProgram);
+    skinnedShaderProgram = util::loadShaderProgram(shaders::skinned, SHADER_CACHE_DIR);
+    assert(skinnedShaderProgram);
+    upscaleProgram = util::loadShaderProgram(shaders::upscale, SHADER_CACHE_DIR);
+    assert(upscaleProgram);
+    sharpUpscaleProgram = util::loadShaderProgram(shaders::upscale_sharp, SHADER_CACHE_DIR);
+    assert(sharpUpscaleProgram);
+    depthProgram = util::loadShaderProgram(shaders::depth, SHADER_CACHE_DIR);
+    assert(depthProgram);
+    skinnedDepthProgram = util::loadShaderProgram(shaders::depth_skinned, SHADER_CACHE_DIR);
+    assert(skinnedDepthProgram);
+    overdrawProgram = util::loadShaderProgram(shaders::overdraw, SHADER_CACHE_DIR);
+    assert(overdrawProgram);
+#ifdef SHADER_HOT_RELOAD
+    shaderHotReloader.add(shaders::sprite, shaderProgram);
+    shaderHotReloader.add(shaders::skinned, skinnedShaderProgram);
+    shaderHotReloader.add(shaders::upscale, upscaleProgram);
+    shaderHotReloader.add(shaders::upscale_sharp, sharpUpscaleProgram);
+    shaderHotReloader.add(shaders::depth, depthProgram);
+    shaderHotReloader.add(shaders::depth_skinned, skinnedDepthProgram);
+    shaderHotReloader.add(shaders::overdraw, overdrawProgram);
 #endif
 
-    shaderProgram = loadShader(vertexSource.c_str(), fragmentSource.c_str());
+    renderTarget.create(renderWidth, renderHeight);
+    uniformRing.init(64 * 1024);
+    emptyVao = GLVertexArray::create();
+    gpuTimer.init();
+    nearestClampSampler = GLSampler::create();
+    linearClampSampler = GLSampler::create();
+    for (const auto& [s, filter] :
+         {std::pair{nearestClampSampler.get(), GL_NEAREST},
+          std::pair{linearClampSampler.get(), GL_LINEAR}}) {
+        glSamplerParameteri(s, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glSamplerParameteri(s, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glSamplerParameteri(s, GL_TEXTURE_MIN_FILTER, filter);
+        glSamplerParameteri(s, GL_TEXTURE_MAG_FILTER, filter);
+    }
     initGeometry();
 
-    model = util::loadModel("assets/models/yae.gltf");
-    // let's assume one mesh for now
-    assert(model.meshes.size() == 1);
-    auto& mesh = model.meshes[0];
-    mesh.initGeometry();
-    mesh.diffuseTexture = loadTexture(mesh.materialPath.c_str(), false);
+    registry.create(
+        Transform{.position = {}, .rotationAngle = 0.f, .world = glm::mat4{1.f}},
+        Spin{.speed = 0.5f},
+        Renderable{.mesh = 0, .visible = true},
+        AnimationState{.time = 0.f});
+    assetStreamer.request(
+        MODEL_PATH,
+        util::AssetStreamer::Priority::Normal,
+        [this](const std::filesystem::path& path, bool ok) {
+            if (ok) {
+                onModelStreamed(path);
+            }
+        });
 
     // init camera
     {
@@ -309,16 +336,83 @@ void Game::start()
     }
 
     prev_time = SDL_GetTicks();
+    prevFrameCounter = SDL_GetPerformanceCounter();
+
+    if (useRenderThread) {
+        // streaming callbacks create GL objects on the main thread, so load everything
+        // before handing the context over (the render thread is native only, so it's fast)
+        assetStreamer.finishAll();
+
+        // create ImGui's GL objects while the context is still current here
+        ImGui_ImplOpenGL3_NewFrame();
+
+        // hand the context over to the render thread
+        SDL_GL_MakeCurrent(window, nullptr);
+        isRenderThreadRunning = true;
+        renderThread = std::thread([this]() { renderThreadLoop(); });
+    }
+}
+
+void Game::onModelStreamed(const std::filesystem::path& path)
+{
+    // positions and indices stay on the CPU for picking and occlusion culling
+    model = util::loadModel(path, Mesh::Residency::KeepPositionsAndIndices);
+    if (model.meshes.empty()) {
+        return; // the loader has logged the error
+    }
+    // let's assume one mesh for now
+    assert(model.meshes.size() == 1);
+    model.meshes[0].initGeometry();
+    // from the bind pose - picking skinned meshes is approximate
+    meshBVH.build(model.meshes[0].positions, model.meshes[0].data.indices, &taskScheduler);
+    jointMatrices.resize(registry.getNumSlots() * model.skeleton.getNumJoints());
+
+    // needed right away, so it goes before anything requested later
+    assetStreamer.request(
+        model.meshes[0].data.materialPath,
+        util::AssetStreamer::Priority::High,
+        [this](const std::filesystem::path& path, bool ok) {
+            if (ok) {
+                model.meshes[0].diffuseTexture = loadTexture(path.string().c_str(), false);
+                isModelReady = true;
+            }
+        });
 }
 
 void Game::onQuit()
 {
-    glDeleteSamplers(1, &sampler);
-    glDeleteTextures(1, &texture);
-    glDeleteProgram(shaderProgram);
-    glDeleteBuffers(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
+    if (renderThread.joinable()) {
+        isRenderThreadRunning = false;
+        framePackets.wake();
+        renderThread.join();
+        SDL_GL_MakeCurrent(window, glContext);
+    }
+
+    inputQueue.stop();
+
+    sampler.reset();
+    texture.reset();
+    uniformRing = UniformBufferRing{};
+    shaderProgram.reset();
+    skinnedShaderProgram.reset();
+    renderTarget = RenderTarget{};
+    upscaleProgram.reset();
+    sharpUpscaleProgram.reset();
+    depthProgram.reset();
+    skinnedDepthProgram.reset();
+    overdrawProgram.reset();
+    nearestClampSampler.reset();
+    linearClampSampler.reset();
+    emptyVao.reset();
+    gpuTimer = GPUTimer{};
+    vao.reset();
+    vbo.reset();
+    ebo.reset();
+    model = Model{};
+    isModelReady = false;
+    // GL objects must be deleted while the context is still alive
+    flushGLDeletionQueue();
+    util::unmountAssetPacks();
 
     SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(window);
@@ -364,16 +458,23 @@ void Game::loopIteration()
         if (emscripten_get_fullscreen_status(&e) != EMSCRIPTEN_RESULT_SUCCESS) return;
         handleFullscreenChange(e.isFullscreen, e.screenWidth, e.screenHeight);
     }
-#else
-    // i3 is silly - doesn't send any events on maximize/minimize
-    int w, h;
-    SDL_GetWindowSize(window, &w, &h);
-    screenWidth = w;
-    screenHeight = h;
 #endif
 
+#ifdef SHADER_HOT_RELOAD
+    shaderHotReloader.update();
+#endif
+    assetStreamer.update();
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    util::flushLog(); // no writer thread
+#endif
+
+    // pumped before reading the time, so that everything which arrived until now is
+    // stamped before frameCounter and reaches this frame's steps
+    const bool hadInput = processInput();
+
     // Fix your timestep! game loop
     uint32_t new_time = SDL_GetTicks();
+    const auto frameCounter = SDL_GetPerformanceCounter();
     const auto frame_time = (new_time - prev_time) / 1000.f;
     accumulator += frame_time;
     prev_time = new_time;
@@ -382,119 +483,733 @@ void Game::loopIteration()
         accumulator = dt;
     }
 
+    // only the simulation runs at a fixed step, so catching up doesn't rebuild the UI.
+    // Each step gets the input which happened before the (real) time it ends at, the last
+    // one gets everything until now, so that no input waits for the next frame.
+    const auto frequency = SDL_GetPerformanceFrequency();
+    const auto tickDuration = static_cast<std::uint64_t>(dt * frequency);
+    auto tickEnd = frameCounter - static_cast<std::uint64_t>(accumulator * frequency);
     while (accumulator >= dt) {
-        { // event processing
-            SDL_Event event;
-            while (SDL_PollEvent(&event)) {
-                if (event.type == SDL_QUIT) {
-                    isRunning = false;
-                }
-
-#ifndef __EMSCRIPTEN__
-                switch (event.type) {
-                case SDL_WINDOWEVENT: {
-                    switch (event.window.type) {
-                    case SDL_WINDOWEVENT_RESIZED:
-                    case SDL_WINDOWEVENT_SIZE_CHANGED:
-                    case SDL_WINDOWEVENT_MAXIMIZED:
-                        screenWidth = event.window.data1;
-                        screenHeight = event.window.data1;
-                        break;
-                    }
-                }
-                }
-#endif
+        tickEnd += tickDuration;
+        const auto inputEnd = accumulator < 2 * dt ? frameCounter : tickEnd;
+        const auto tickInputEnd =
+            std::find_if(pendingInput.begin(), pendingInput.end(), [inputEnd](const auto& e) {
+                return e.timestamp > inputEnd;
+            });
+        update(dt, std::span(pendingInput.begin(), tickInputEnd));
+        pendingInput.erase(pendingInput.begin(), tickInputEnd);
+        accumulator -= dt;
+    }
 
-                ImGui_ImplSDL2_ProcessEvent(&event);
-            }
+    if (shouldRebuildUI(hadInput, new_time)) {
+        if (!useRenderThread) {
+            ImGui_ImplOpenGL3_NewFrame();
         }
-
-        ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplSDL2_NewFrame();
         ImGui::NewFrame();
 
-        update(dt);
-
-        accumulator -= dt;
+        updateUI();
 
         ImGui::Render();
     }
 
+    updateRenderScale();
     draw();
 
 #ifndef __EMSCRIPTEN__
-    // Delay to not overload the CPU
-    const auto frameTime = (SDL_GetTicks() - prev_time) / 1000.f;
-    if (dt > frameTime) {
-        SDL_Delay(dt - frameTime);
+    // Delay to not overload the CPU. Wait for events instead of sleeping, so that the
+    // input queue's event watch timestamps them as they arrive, not on the next frame.
+    const auto frameDuration = static_cast<std::uint32_t>(dt * 1000.f);
+    for (auto elapsed = SDL_GetTicks() - prev_time; elapsed < frameDuration;
+         elapsed = SDL_GetTicks() - prev_time) {
+        if (SDL_WaitEventTimeout(nullptr, frameDuration - elapsed)) {
+            // already in the input queue
+            SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+        }
+    }
+#endif
+}
+
+bool Game::processInput()
+{
+#ifndef __EMSCRIPTEN__
+    // on the web SDL queues events from browser callbacks, natively they're only
+    // read from the OS here
+    SDL_PumpEvents();
+#endif
+    // everything is in the input queue already
+    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+    bool hadInput = false;
+    util::InputEvent e;
+    while (inputQueue.pop(e)) {
+        hadInput = true;
+        const auto& event = e.event;
+        if (event.type == SDL_QUIT) {
+            isRunning = false;
+        }
+
+#ifndef __EMSCRIPTEN__
+        if (event.type == SDL_WINDOWEVENT) {
+            switch (event.window.event) {
+            case SDL_WINDOWEVENT_RESIZED:
+            case SDL_WINDOWEVENT_SIZE_CHANGED:
+            case SDL_WINDOWEVENT_MAXIMIZED:
+                screenWidth = event.window.data1;
+                screenHeight = event.window.data2;
+                break;
+            }
+        }
+#endif
+
+        // the UI is built once per frame, so it gets everything right away
+        ImGui_ImplSDL2_ProcessEvent(&event);
+        pendingInput.push_back(e);
     }
+
+#ifndef __EMSCRIPTEN__
+    // i3 is silly - doesn't send any events on maximize/minimize
+    int w, h;
+    SDL_GetWindowSize(window, &w, &h);
+    screenWidth = w;
+    screenHeight = h;
 #endif
+    return hadInput;
+}
+
+void Game::setNumExtraInstances(std::size_t count)
+{
+    if (count < extraInstances.size()) {
+        const auto removed = std::span{extraInstances}.subspan(count);
+        registry.destroy(removed);
+        extraInstances.resize(count);
+        return;
+    }
+
+    const auto first = extraInstances.size();
+    extraInstances.resize(count);
+    const auto added = std::span{extraInstances}.subspan(first);
+    registry.createMany(
+        added,
+        Spin{.speed = 0.5f},
+        Renderable{.mesh = 0, .visible = true},
+        AnimationState{.time = 0.f},
+        Transform{});
+    // rows of instances going away from the camera
+    static constexpr std::size_t rowSize = 64;
+    static constexpr float spacing = 2.f;
+    for (auto i = first; i < count; ++i) {
+        auto& transform = registry.get<Transform>(extraInstances[i]);
+        const auto column = static_cast<float>(i % rowSize) - (rowSize - 1) * 0.5f;
+        const auto row = static_cast<float>(i / rowSize + 1);
+        transform.position = glm::vec3{column * spacing, 0.f, -row * spacing};
+        transform.rotationAngle = static_cast<float>(i) * 0.1f;
+        transform.world = makeWorldTransform(transform.position, transform.rotationAngle);
+        registry.get<AnimationState>(extraInstances[i]).time = static_cast<float>(i) * 0.05f;
+    }
+    jointMatrices.resize(registry.getNumSlots() * model.skeleton.getNumJoints());
+}
+
+void Game::update(float dt, std::span<const util::InputEvent> input)
+{
+    static constexpr std::size_t transformGrainSize = 256;
+    registry.forEachChunk<Transform, Spin>(
+        [this, dt](
+            std::span<const util::Entity>, std::span<Transform> transforms, std::span<Spin> spins) {
+            taskScheduler.parallelFor(
+                transforms.size(), transformGrainSize, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i) {
+                        auto& transform = transforms[i];
+                        transform.rotationAngle += spins[i].speed * dt;
+                        transform.world =
+                            makeWorldTransform(transform.position, transform.rotationAngle);
+                    }
+                });
+        });
+
+    if (isModelReady && model.hasSkeleton()) {
+        updateAnimations(dt);
+    }
+
+    for (const auto& e : input) {
+        const auto& event = e.event;
+        if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT &&
+            !ImGui::GetIO().WantCaptureMouse) {
+            pick(event.button.x, event.button.y);
+        }
+    }
+}
+
+void Game::pick(int x, int y)
+{
+    hasPickHit = false;
+    if (!isModelReady) {
+        return;
+    }
+
+    // window coordinates -> NDC of the letterboxed scene (window y goes down, GL's up)
+    const auto viewport = doLetterboxing(screenWidth, screenHeight, scaleMode);
+    const auto viewportTop = screenHeight - viewport.y - viewport.w;
+    const auto ndcX = (x - viewport.x) / static_cast<float>(viewport.z) * 2.f - 1.f;
+    const auto ndcY = 1.f - (y - viewportTop) / static_cast<float>(viewport.w) * 2.f;
+    if (std::abs(ndcX) > 1.f || std::abs(ndcY) > 1.f) {
+        return; // clicked on the bars
+    }
+
+    const auto invVP = glm::inverse(cameraProj * cameraView);
+    auto nearPoint = invVP * glm::vec4{ndcX, ndcY, -1.f, 1.f};
+    auto farPoint = invVP * glm::vec4{ndcX, ndcY, 1.f, 1.f};
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    // instances move every step, so the top level is rebuilt for each query
+    bvhInstances.clear();
+    bvhEntities.clear();
+    registry.forEach<Transform, Renderable>(
+        [this](util::Entity e, const Transform& transform, const Renderable&) {
+            bvhInstances.push_back(
+                SceneBVH::Instance{.mesh = &meshBVH, .transform = transform.world});
+            bvhEntities.push_back(e);
+        });
+    sceneBVH.build(bvhInstances, &taskScheduler);
+
+    // distances are relative to the near-far segment
+    const Ray ray{
+        .origin = glm::vec3{nearPoint},
+        .direction = glm::vec3{farPoint - nearPoint},
+        .maxDistance = 1.f,
+    };
+    hasPickHit = sceneBVH.raycast(ray, pickHit);
+    if (hasPickHit) {
+        pickedEntity = bvhEntities[pickHit.instance];
+    }
 }
 
-void Game::update(float dt)
+bool Game::shouldRebuildUI(bool hadInput, std::uint32_t now)
 {
-    meshRotationAngle += 0.5f * dt;
+    if (hadInput) {
+        // widgets can take a frame to react (e.g. auto-sized windows and popups)
+        uiFramesToRebuild = 2;
+    }
+    if (!cacheUI || uiFramesToRebuild > 0 || now - lastUIBuildTime >= UI_REFRESH_INTERVAL_MS ||
+        !ImGui::GetDrawData()) {
+        uiFramesToRebuild = std::max(uiFramesToRebuild - 1, 0);
+        lastUIBuildTime = now;
+        return true;
+    }
+    return false;
+}
 
+void Game::updateUI()
+{
     ImGui::Begin("Test window");
     ImGui::TextUnformatted("Emscripten tests");
     ImGui::Text("screen size: %d, %d", screenWidth, screenHeight);
     int w, h;
     SDL_GetWindowSize(window, &w, &h);
     ImGui::Text("window size: %d, %d", w, h);
+
+    int mode = static_cast<int>(scaleMode);
+    if (ImGui::Combo("Scale mode", &mode, "Fit\0Integer\0")) {
+        scaleMode = static_cast<ScaleMode>(mode);
+    }
+    int filter = static_cast<int>(upscaleFilter);
+    if (ImGui::Combo("Upscale filter", &filter, "Nearest\0Sharp bilinear\0")) {
+        upscaleFilter = static_cast<UpscaleFilter>(filter);
+    }
+    ImGui::Checkbox("Depth pre-pass", &useDepthPrepass);
+    ImGui::Checkbox("Show overdraw", &showOverdraw);
+    ImGui::Checkbox("Dynamic resolution", &useDynamicResolution);
+    ImGui::Checkbox("Cache UI", &cacheUI);
+    if (ImGui::SliderInt("Extra instances", &numExtraInstances, 0, MAX_EXTRA_INSTANCES)) {
+        setNumExtraInstances(static_cast<std::size_t>(numExtraInstances));
+    }
+    ImGui::Text(
+        "entities: %zu, archetypes: %zu",
+        registry.getNumEntities(),
+        registry.getNumArchetypes());
+    // skinned meshes occlude with their bind pose
+    ImGui::Checkbox("Occlusion culling", &useOcclusionCulling);
+    if (useOcclusionCulling) {
+        ImGui::Text(
+            "occluder triangles: %zu, occluded instances: %zu",
+            occlusionCuller.getNumOccluderTriangles(),
+            numOccludedInstances);
+        ImGui::Checkbox("Show occlusion buffer", &showOcclusionBuffer);
+    }
+    if (hasPickHit) {
+        ImGui::Text("picked: entity %u, triangle %u", pickedEntity.index, pickHit.triangle);
+    } else {
+        ImGui::TextUnformatted("picked: nothing (click on the model)");
+    }
+    if (useDynamicResolution) {
+        ImGui::Text(
+            "render scale: %.3f (%s time: %.2f ms)",
+            renderScale,
+            gpuFrameTime.load(std::memory_order_relaxed) >= 0.f ? "GPU" : "frame",
+            dynamicResolution.getSmoothedFrameTime() * 1000.f);
+    } else {
+        ImGui::SliderFloat("Render scale", &renderScale, 0.25f, 1.f);
+    }
     ImGui::End();
+
+    if (useOcclusionCulling && showOcclusionBuffer) {
+        drawOcclusionBuffer();
+    }
+}
+
+void Game::drawOcclusionBuffer()
+{
+    // a coarse level, so that it's only a few thousand rects
+    static constexpr int level = 2;
+    static constexpr float texelSize = 4.f;
+    const auto width = occlusionCuller.getWidth(level);
+    const auto height = occlusionCuller.getHeight(level);
+
+    ImGui::Begin("Occlusion buffer", &showOcclusionBuffer, ImGuiWindowFlags_AlwaysAutoResize);
+    // depth is non-linear and mostly close to 1, so it's stretched between the nearest
+    // texel and the far plane
+    float minDepth = 1.f;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            minDepth = std::min(minDepth, occlusionCuller.getDepth(level, x, y));
+        }
+    }
+    const auto range = std::max(1.f - minDepth, 1e-6f);
+
+    const auto origin = ImGui::GetCursorScreenPos();
+    auto* drawList = ImGui::GetWindowDrawList();
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const auto depth = occlusionCuller.getDepth(level, x, y);
+            const auto c = static_cast<int>((1.f - depth) / range * 255.f);
+            // rows go from the bottom to the top
+            const ImVec2 min{origin.x + x * texelSize, origin.y + (height - 1 - y) * texelSize};
+            drawList->AddRectFilled(
+                min, ImVec2{min.x + texelSize, min.y + texelSize}, IM_COL32(c, c, c, 255));
+        }
+    }
+    ImGui::Dummy(ImVec2{width * texelSize, height * texelSize});
+    ImGui::End();
+}
+
+void Game::updateAnimations(float dt)
+{
+    const auto& skeleton = model.skeleton;
+    const auto numJoints = skeleton.getNumJoints();
+    const auto* clip = model.animations.empty() ? nullptr : &model.animations[0];
+
+    static constexpr std::size_t animationGrainSize = 16;
+    registry.forEachChunk<AnimationState>([&](std::span<const util::Entity> entities,
+                                              std::span<AnimationState> states) {
+        taskScheduler.parallelFor(
+            entities.size(), animationGrainSize, [&](std::size_t begin, std::size_t end) {
+                // per-task scratch memory, reused for all entities in the range
+                SkeletonPose pose;
+                JointPaletteScratch scratch;
+                for (std::size_t i = begin; i < end; ++i) {
+                    pose = skeleton.restPose;
+                    if (clip) {
+                        auto& time = states[i].time;
+                        time += dt;
+                        if (clip->duration > 0.f) {
+                            time = std::fmod(time, clip->duration);
+                        }
+                        clip->sample(time, pose);
+                    }
+                    computeJointPalette(
+                        skeleton, pose, scratch, &jointMatrices[entities[i].index * numJoints]);
+                }
+            });
+    });
+}
+
+void Game::updateRenderScale()
+{
+    const auto now = SDL_GetPerformanceCounter();
+    const auto frameInterval =
+        static_cast<float>(now - prevFrameCounter) / SDL_GetPerformanceFrequency();
+    prevFrameCounter = now;
+    if (!useDynamicResolution) {
+        return;
+    }
+
+    // GPU time is only known on desktop, on the web the frame interval has to do
+    const auto gpuTime = gpuFrameTime.load(std::memory_order_relaxed);
+    const bool hasGPUTime = gpuTime >= 0.f;
+    dynamicResolution.update(hasGPUTime ? gpuTime : frameInterval, hasGPUTime);
+    renderScale = dynamicResolution.getScale();
 }
 
 void Game::draw()
 {
+    auto& packet = framePackets.getWriteBuffer();
+    buildFramePacket(packet);
+
+    if (useRenderThread) {
+        packet.imguiDrawData.copyFrom(*ImGui::GetDrawData());
+        packet.frameIndex = numPublishedPackets;
+        framePackets.publish();
+        // objects released from now on can still be used by the published packets
+        setGLDeletionFrame(++numPublishedPackets);
+        return;
+    }
+
+    drawFrame(packet, ImGui::GetDrawData());
+    // frame boundary - safe to delete GL objects which are no longer used
+    flushGLDeletionQueue();
+}
+
+void Game::buildFramePacket(FramePacket& packet)
+{
+    packet.screenWidth = screenWidth;
+    packet.screenHeight = screenHeight;
+    packet.scaleMode = scaleMode;
+    packet.upscaleFilter = upscaleFilter;
+    packet.renderScale = renderScale;
+    packet.depthPrepass = useDepthPrepass;
+    packet.showOverdraw = showOverdraw;
+
+    packet.view = cameraView;
+    packet.proj = cameraProj;
+    packet.vp = cameraProj * cameraView;
+    packet.time = SDL_GetTicks() / 1000.f;
+    packet.drawItems.clear();
+    packet.jointMatrices.clear();
+    if (!isModelReady) {
+        return;
+    }
+
+    updateVisibility(packet.vp);
+
+    // opaque meshes go front to back, so that hidden fragments fail the depth test early
+    const auto& mesh = model.meshes[0];
+    const auto center = (mesh.data.boundsMin + mesh.data.boundsMax) * 0.5f;
+    drawOrder.clear();
+    registry.forEach<Transform, Renderable>(
+        [this, &center](util::Entity e, const Transform& transform, const Renderable& renderable) {
+            if (!renderable.visible) {
+                return;
+            }
+            const auto worldCenter = glm::vec3{transform.world * glm::vec4{center, 1.f}};
+            const auto toCenter = worldCenter - cameraPos;
+            drawOrder.emplace_back(glm::dot(toCenter, toCenter), e);
+        });
+    std::sort(drawOrder.begin(), drawOrder.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+    if (useOcclusionCulling) {
+        updateOcclusion(packet.vp);
+    }
+
+    const auto numJoints = mesh.skinned ? model.skeleton.getNumJoints() : 0;
+    for (const auto& [distance, e] : drawOrder) {
+        if (!registry.get<Renderable>(e).visible) {
+            continue; // occluded
+        }
+        packet.drawItems.push_back(FramePacket::DrawItem{
+            .vao = mesh.vao.get(),
+            .texture = mesh.diffuseTexture.get(),
+            .numIndices = static_cast<std::uint32_t>(mesh.numIndices),
+            .transform = registry.get<Transform>(e).world,
+            .jointOffset = static_cast<std::uint32_t>(packet.jointMatrices.size()),
+            .numJoints = static_cast<std::uint32_t>(numJoints),
+        });
+        const auto* palette = jointMatrices.data() + e.index * numJoints;
+        packet.jointMatrices.insert(packet.jointMatrices.end(), palette, palette + numJoints);
+    }
+}
+
+void Game::drawFrame(const FramePacket& packet, ImDrawData* imguiDrawData)
+{
+#ifdef SHADER_HOT_RELOAD
+    // swap programs only between frames
+    shaderHotReloader.applyPendingReloads();
+#endif
+    gpuTimer.begin();
+
+    // the scene is drawn into the top left part of the target, so that changing
+    // the render scale doesn't need to reallocate it
+    const auto sceneWidth = std::max(1, static_cast<int>(renderWidth * packet.renderScale));
+    const auto sceneHeight = std::max(1, static_cast<int>(renderHeight * packet.renderScale));
+    renderTarget.bind();
+    glViewport(0, 0, sceneWidth, sceneHeight);
+    drawScene(packet);
+
     // clear whole window with black color
-    glDisable(GL_SCISSOR_TEST);
-    glViewport(0, 0, screenWidth, screenHeight);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, packet.screenWidth, packet.screenHeight);
     glClearColor(0.f, 0.f, 0.f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // setup new draw area
-    doLetterboxing();
+    drawUpscaledScene(packet, sceneWidth, sceneHeight);
+
+    if (imguiDrawData) {
+        ImGui_ImplOpenGL3_RenderDrawData(imguiDrawData);
+    }
+
+    gpuTimer.end();
+    gpuFrameTime.store(gpuTimer.getLatest(), std::memory_order_relaxed);
 
-    // draw
+    SDL_GL_SwapWindow(window);
+}
+
+void Game::drawScene(const FramePacket& packet)
+{
     glEnable(GL_CULL_FACE);
     glFrontFace(GL_CCW);
     glCullFace(GL_BACK);
 
     glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+
+    // both passes use the same uniforms, so they're only uploaded once
+    uploadUniforms(packet);
+    uniformRing.bindRange(UniformBlock::Frame, frameUniforms, sizeof(FrameUniforms));
+
+    if (packet.depthPrepass) {
+        // with the depth laid down first, every pixel is shaded only once
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        drawMeshes(packet, depthProgram.get(), skinnedDepthProgram.get(), false);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_FALSE);
+    }
 
-    // draw BG
-    glDisable(GL_DEPTH_TEST);
-    glm::mat4 spriteTransform{1.f};
-    shaderSetUniformMatrix(shaderProgram, "vp", 0, glm::mat4{1.f});
-    shaderSetUniformMatrix(shaderProgram, "model", 1, spriteTransform);
-    shaderBindSampler(shaderProgram, "tex", 2, 0, texture, sampler);
-    glBindVertexArray(vao);
+    if (packet.showOverdraw) {
+        // count fragments which pass the depth test (i.e. get shaded) per pixel
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 0, 0xff);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+    }
+
+    drawMeshes(packet, shaderProgram.get(), skinnedShaderProgram.get(), true);
+
+    // draw BG last at the far plane, so it only covers pixels where there are no meshes
+    glDepthMask(GL_FALSE);
+    setDepthRange(1.f, 1.f);
+    glUseProgram(shaderProgram.get());
+    uniformRing.bindRange(UniformBlock::Frame, backgroundFrameUniforms, sizeof(FrameUniforms));
+    uniformRing.bindRange(UniformBlock::Object, backgroundObjectUniforms, sizeof(ObjectUniforms));
+    shaderBindSampler(shaderProgram.get(), "tex", 2, 0, texture.get(), sampler.get());
+    glBindVertexArray(vao.get());
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+    setDepthRange(0.f, 1.f);
+    glDepthMask(GL_TRUE);
 
-    // draw model
-    auto vp = cameraProj * cameraView;
-    glEnable(GL_DEPTH_TEST);
-    glm::mat4 meshTransform{1.f};
-    meshTransform = glm::rotate(meshTransform, meshRotationAngle, glm::vec3{0.f, 1.f, 0.f});
+    if (packet.showOverdraw) {
+        drawOverdraw();
+        glDisable(GL_STENCIL_TEST);
+    }
+}
+
+void Game::uploadUniforms(const FramePacket& packet)
+{
+    uniformRing.beginFrame();
+
+    const auto time = glm::vec4{packet.time, 0.f, 0.f, 0.f};
+    frameUniforms = uniformRing.push(FrameUniforms{
+        .view = packet.view,
+        .proj = packet.proj,
+        .vp = packet.vp,
+        .time = time,
+    });
+    // BG sprite is already in clip space
+    backgroundFrameUniforms = uniformRing.push(FrameUniforms{
+        .view = glm::mat4{1.f},
+        .proj = glm::mat4{1.f},
+        .vp = glm::mat4{1.f},
+        .time = time,
+    });
+    backgroundObjectUniforms = uniformRing.push(ObjectUniforms{.model = glm::mat4{1.f}});
+
+    drawItemUniforms.clear();
+    for (const auto& item : packet.drawItems) {
+        DrawItemUniforms offsets{};
+        offsets.object = uniformRing.push(ObjectUniforms{.model = item.transform});
+        if (item.numJoints != 0) {
+            // the bound range can't be smaller than the block, even if fewer joints are used
+            offsets.skin = uniformRing.allocate(sizeof(glm::mat4) * MAX_JOINTS);
+            // loaders reject bigger skeletons, this only guards the allocation
+            assert(item.numJoints <= MAX_JOINTS);
+            const auto numJoints = std::min<std::size_t>(item.numJoints, MAX_JOINTS);
+            std::memcpy(
+                uniformRing.getData(offsets.skin),
+                &packet.jointMatrices[item.jointOffset],
+                sizeof(glm::mat4) * numJoints);
+        }
+        drawItemUniforms.push_back(offsets);
+    }
+
+    uniformRing.upload();
+}
+
+void Game::drawMeshes(
+    const FramePacket& packet,
+    std::uint32_t program,
+    std::uint32_t skinnedProgram,
+    bool isColorPass)
+{
+    for (std::size_t i = 0; i < packet.drawItems.size(); ++i) {
+        const auto& item = packet.drawItems[i];
+        const auto& offsets = drawItemUniforms[i];
+        const auto p = item.numJoints != 0 ? skinnedProgram : program;
+        glUseProgram(p);
+        uniformRing.bindRange(UniformBlock::Object, offsets.object, sizeof(ObjectUniforms));
+        if (isColorPass) {
+            shaderBindSampler(p, "tex", 2, 0, item.texture, sampler.get());
+        }
+        if (item.numJoints != 0) {
+            uniformRing.bindRange(
+                UniformBlock::Skin, offsets.skin, sizeof(glm::mat4) * MAX_JOINTS);
+        }
+        glBindVertexArray(item.vao);
+        glDrawElements(GL_TRIANGLES, item.numIndices, GL_UNSIGNED_SHORT, 0);
+    }
+}
+
+void Game::drawOverdraw()
+{
+    // black - not drawn, blue - once, then green, yellow, orange, red - 5 times or more
+    static const glm::vec4 colors[] = {
+        {0.f, 0.f, 0.f, 1.f},
+        {0.f, 0.2f, 0.8f, 1.f},
+        {0.f, 0.8f, 0.2f, 1.f},
+        {1.f, 1.f, 0.f, 1.f},
+        {1.f, 0.5f, 0.f, 1.f},
+        {1.f, 0.f, 0.f, 1.f},
+    };
+    constexpr int numColors = static_cast<int>(std::size(colors));
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glUseProgram(overdrawProgram.get());
+    glBindVertexArray(emptyVao.get());
+    for (int i = 0; i < numColors; ++i) {
+        // the last color is for everything above (ref <= stencil)
+        glStencilFunc(i + 1 < numColors ? GL_EQUAL : GL_LEQUAL, i, 0xff);
+        shaderSetUniformVec4(overdrawProgram.get(), "color", 0, colors[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+}
+
+void Game::drawUpscaledScene(const FramePacket& packet, int sceneWidth, int sceneHeight)
+{
+    const auto viewport =
+        doLetterboxing(packet.screenWidth, packet.screenHeight, packet.scaleMode);
+    glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+
+    const bool isSharp = packet.upscaleFilter == UpscaleFilter::SharpBilinear;
+    const auto program = isSharp ? sharpUpscaleProgram.get() : upscaleProgram.get();
+    const auto sceneSize = glm::vec2{sceneWidth, sceneHeight};
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glUseProgram(program);
+    shaderBindSampler(
+        program,
+        "tex",
+        0,
+        0,
+        renderTarget.getColorTexture(),
+        isSharp ? linearClampSampler.get() : nearestClampSampler.get());
+    shaderSetUniformVec2(program, "sourceSize", 1, sceneSize);
+    shaderSetUniformVec2(
+        program, "textureSize", 2, glm::vec2{renderTarget.getWidth(), renderTarget.getHeight()});
+    if (isSharp) {
+        shaderSetUniformVec2(program, "scale", 3, glm::vec2{viewport.z, viewport.w} / sceneSize);
+    }
+    glBindVertexArray(emptyVao.get());
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void Game::renderThreadLoop()
+{
+    SDL_GL_MakeCurrent(window, glContext);
+
+    while (isRenderThreadRunning) {
+        framePackets.waitForNew();
+        if (!framePackets.acquireLatest()) {
+            continue; // woken up for shutdown
+        }
+
+        auto& packet = framePackets.getReadBuffer();
+        drawFrame(packet, packet.imguiDrawData.get());
+        // older packets were either drawn or dropped, so the objects released before
+        // this one was built aren't used anymore
+        flushGLDeletionQueue(packet.frameIndex);
+    }
+
+    SDL_GL_MakeCurrent(window, nullptr);
+}
+
+void Game::updateVisibility(const glm::mat4& vp)
+{
+    const auto frustum = Frustum::fromMatrix(vp);
     const auto& mesh = model.meshes[0];
-    shaderSetUniformMatrix(shaderProgram, "vp", 0, vp);
-    shaderSetUniformMatrix(shaderProgram, "model", 1, meshTransform);
-    shaderBindSampler(shaderProgram, "tex", 2, 0, mesh.diffuseTexture, sampler);
-    glBindVertexArray(mesh.vao);
-    glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_SHORT, 0);
 
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    // bounding sphere of the mesh (instances aren't scaled, so the radius doesn't change)
+    const auto center = (mesh.data.boundsMin + mesh.data.boundsMax) * 0.5f;
+    const auto radius = glm::length(mesh.data.boundsMax - center);
+
+    static constexpr std::size_t visibilityGrainSize = 1024;
+    registry.forEachChunk<Transform, Renderable>(
+        [&](std::span<const util::Entity>,
+            std::span<Transform> transforms,
+            std::span<Renderable> renderables) {
+            taskScheduler.parallelFor(
+                transforms.size(), visibilityGrainSize, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i) {
+                        const auto worldCenter =
+                            glm::vec3{transforms[i].world * glm::vec4{center, 1.f}};
+                        renderables[i].visible = frustum.intersectsSphere(worldCenter, radius);
+                    }
+                });
+        });
+}
 
-    SDL_GL_SwapWindow(window);
+void Game::updateOcclusion(const glm::mat4& vp)
+{
+    const auto& mesh = model.meshes[0];
+    occlusionCuller.beginFrame(vp);
+    // the closest visible instances are the most likely to hide something
+    const auto numOccluders = std::min(drawOrder.size(), MAX_OCCLUDERS);
+    for (std::size_t i = 0; i < numOccluders; ++i) {
+        occlusionCuller.addOccluder(
+            mesh.positions, mesh.data.indices, registry.get<Transform>(drawOrder[i].second).world);
+    }
+    occlusionCuller.rasterize(&taskScheduler);
+
+    // occluders are drawn anyway, so only the rest are tested
+    static constexpr std::size_t occlusionGrainSize = 256;
+    std::atomic<std::size_t> numOccluded{0};
+    taskScheduler.parallelFor(
+        drawOrder.size() - numOccluders,
+        occlusionGrainSize,
+        [this, &mesh, &numOccluded, numOccluders](std::size_t begin, std::size_t end) {
+            std::size_t n = 0;
+            for (auto j = begin; j < end; ++j) {
+                const auto e = drawOrder[numOccluders + j].second;
+                if (!occlusionCuller.isVisible(
+                        mesh.data.boundsMin,
+                        mesh.data.boundsMax,
+                        registry.get<Transform>(e).world)) {
+                    registry.get<Renderable>(e).visible = false;
+                    ++n;
+                }
+            }
+            numOccluded += n;
+        });
+    numOccludedInstances = numOccluded;
 }
 
 void Game::handleFullscreenChange(bool isFullscreen, int newScreenWidth, int newScreenHeight)
 {
     this->isFullscreen = isFullscreen;
-    // printf("handle fullscreen change!\n");
 
     int w, h;
     SDL_GetWindowSize(window, &w, &h);
@@ -515,17 +1230,22 @@ void Game::handleFullscreenChange(bool isFullscreen, int newScreenWidth, int new
     }
 }
 
-void Game::doLetterboxing()
+glm::ivec4 Game::doLetterboxing(int frameWidth, int frameHeight, ScaleMode mode) const
 {
-    const float sw = screenWidth;
-    const float sh = screenHeight;
+    const float sw = frameWidth;
+    const float sh = frameHeight;
     const float ratio = (float)renderWidth / (float)renderHeight;
 
-    // TODO: integer scale mode
-
     // letterboxing
     float vp[4] = {0.f, 0.f, sw, sh};
-    if (sw / sh > ratio) { // won't fit horizontally - add vertical bars
+    const auto integerScale = std::min(frameWidth / renderWidth, frameHeight / renderHeight);
+    if (mode == ScaleMode::Integer && integerScale >= 1) {
+        // (fit is used when the window is smaller than the render size)
+        vp[2] = renderWidth * integerScale;
+        vp[3] = renderHeight * integerScale;
+        vp[0] = std::floor((sw - vp[2]) * 0.5f); // center
+        vp[1] = std::floor((sh - vp[3]) * 0.5f);
+    } else if (sw / sh > ratio) { // won't fit horizontally - add vertical bars
         vp[2] = sh * ratio;
         vp[0] = (sw - vp[2]) * 0.5f; // center horizontally
     } else { // won'f fit vertically - add horizonal bars
@@ -533,7 +1253,5 @@ void Game::doLetterboxing()
         vp[1] = (sh - vp[3]) * 0.5f; // center vertically
     }
 
-    glEnable(GL_SCISSOR_TEST);
-    glScissor(vp[0], vp[1], vp[2], vp[3]);
-    glViewport(vp[0], vp[1], vp[2], vp[3]);
+    return glm::ivec4{vp[0], vp[1], vp[2], vp[3]};
 }
@@ -1,19 +1,48 @@
 #include <SDL.h>
 
+#include <atomic>
 #include <cstdint>
-
+#include <filesystem>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <Graphics/DynamicResolution.h>
+#include <Graphics/FramePacket.h>
+#include <Graphics/GLHandle.h>
+#include <Graphics/GPUTimer.h>
+#include <Graphics/MeshBVH.h>
 #include <Graphics/Model.h>
+#include <Graphics/OcclusionCuller.h>
+#include <Graphics/RenderTarget.h>
+#include <Graphics/SceneBVH.h>
+#include <Graphics/ShaderHotReloader.h>
+#include <Graphics/UniformBufferRing.h>
+#include <util/AssetStreamer.h>
+#include <util/EntityRegistry.h>
+#include <util/InputQueue.h>
+#include <util/TaskScheduler.h>
+#include <util/TripleBuffer.h>
 
 #include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
 
 class Game {
 public:
-    void start();
+    struct Params {
+        // native only: GL submission happens on a separate thread
+        bool renderThread{false};
+    };
+
+    void start(const Params& params);
     void onQuit();
     void loop();
     void loopIteration();
 
-    void update(float dt);
+    // fixed step simulation, can run several times per frame.
+    // input - events which happened during the step, oldest first
+    void update(float dt, std::span<const util::InputEvent> input);
     void draw();
 
     void handleFullscreenChange(bool isFullscreen, int screenWidth, int screenHeight);
@@ -21,7 +50,44 @@ public:
     void initGeometry();
 
 private:
-    void doLetterboxing();
+    // returns the window viewport (x, y, width, height) the scene is upscaled to
+    glm::ivec4 doLetterboxing(int frameWidth, int frameHeight, ScaleMode mode) const;
+    void onModelStreamed(const std::filesystem::path& path);
+    // creates or destroys extra instances, so that there are count of them
+    void setNumExtraInstances(std::size_t count);
+    void updateVisibility(const glm::mat4& vp);
+    // hides visible instances which are behind the closest ones, needs drawOrder
+    void updateOcclusion(const glm::mat4& vp);
+    void updateAnimations(float dt);
+    // casts a ray through the window position and stores the closest hit in pickHit
+    void pick(int x, int y);
+    void updateRenderScale();
+    // handles window and UI events and queues the rest for simulation steps,
+    // returns true if there were any events
+    bool processInput();
+    // ImGui windows are built once per rendered frame, not per simulation step
+    void updateUI();
+    // with cacheUI, the last draw data is reused until there's input or it gets stale
+    bool shouldRebuildUI(bool hadInput, std::uint32_t now);
+    // debug view of the CPU depth buffer used for occlusion culling
+    void drawOcclusionBuffer();
+
+    void buildFramePacket(FramePacket& packet);
+    // only calls GL and doesn't touch the simulation state
+    void drawFrame(const FramePacket& packet, ImDrawData* imguiDrawData);
+    void drawScene(const FramePacket& packet);
+    // writes uniforms of everything drawn this frame into uniformRing
+    void uploadUniforms(const FramePacket& packet);
+    // isColorPass is false for the depth pre-pass
+    void drawMeshes(
+        const FramePacket& packet,
+        std::uint32_t program,
+        std::uint32_t skinnedProgram,
+        bool isColorPass);
+    // debug view, colors pixels by the number of times they were shaded (counted in stencil)
+    void drawOverdraw();
+    void drawUpscaledScene(const FramePacket& packet, int sceneWidth, int sceneHeight);
+    void renderThreadLoop();
 
     bool isRunning{false};
     SDL_Window* window{nullptr};
@@ -36,6 +102,10 @@ private:
 
     uint32_t prev_time = 0;
 
+    util::InputQueue inputQueue;
+    // events which weren't consumed by a simulation step yet
+    std::vector<util::InputEvent> pendingInput;
+
     static const int renderWidth = 640;
     static const int renderHeight = 480;
 
@@ -43,20 +113,102 @@ private:
     int screenWidth{0};
     int screenHeight{0};
 
-    std::uint32_t shaderProgram;
-    std::uint32_t vao;
-    std::uint32_t vbo;
-    std::uint32_t ebo;
-
-    std::uint32_t texture;
-    std::uint32_t sampler;
+    GLProgram shaderProgram;
+    GLProgram skinnedShaderProgram;
+    GLProgram depthProgram;
+    GLProgram skinnedDepthProgram;
+    GLProgram overdrawProgram;
+#ifdef SHADER_HOT_RELOAD
+    ShaderHotReloader shaderHotReloader{SHADER_SOURCE_DIR};
+#endif
+    GLVertexArray vao;
+    GLBuffer vbo;
+    GLBuffer ebo;
+
+    GLTexture texture;
+    GLSampler sampler;
+
+    // offsets of this frame's uniform data in uniformRing
+    struct DrawItemUniforms {
+        std::size_t object;
+        std::size_t skin; // only for skinned meshes
+    };
+    UniformBufferRing uniformRing;
+    std::size_t frameUniforms{0};
+    std::size_t backgroundFrameUniforms{0};
+    std::size_t backgroundObjectUniforms{0};
+    std::vector<DrawItemUniforms> drawItemUniforms; // same order as FramePacket::drawItems
+
+    // the scene is drawn at render resolution and then upscaled to the window
+    RenderTarget renderTarget;
+    GLProgram upscaleProgram;
+    GLProgram sharpUpscaleProgram;
+    GLSampler nearestClampSampler;
+    GLSampler linearClampSampler;
+    GLVertexArray emptyVao; // the fullscreen triangle has no vertex attributes
+
+    ScaleMode scaleMode{ScaleMode::Fit};
+    UpscaleFilter upscaleFilter{UpscaleFilter::SharpBilinear};
+    bool useDepthPrepass{false};
+    bool showOverdraw{false};
+
+    // part of renderWidth x renderHeight the scene is drawn at
+    float renderScale{1.f};
+
+    // measured around drawFrame, which can run on the render thread
+    GPUTimer gpuTimer;
+    std::atomic<float> gpuFrameTime{-1.f}; // seconds, negative if unknown
+    DynamicResolution dynamicResolution{dt};
+    bool useDynamicResolution{true};
+
+    static constexpr std::uint32_t UI_REFRESH_INTERVAL_MS = 250; // for text which changes
+    bool cacheUI{true};
+    int uiFramesToRebuild{0};
+    std::uint32_t lastUIBuildTime{0};
+    std::uint64_t prevFrameCounter{0};
 
     Model model;
+    // the model isn't in the boot set, it's drawn once it and its texture are streamed in
+    bool isModelReady{false};
 
     glm::vec3 cameraPos;
     glm::vec3 cameraDirection;
     glm::mat4 cameraView;
     glm::mat4 cameraProj;
 
-    float meshRotationAngle{0.f};
+    // instances of the model, see Components.h
+    util::EntityRegistry registry;
+    // numJoints matrices per entity slot (only for skinned models)
+    std::vector<glm::mat4> jointMatrices;
+    // extra instances placed on a grid behind the first one
+    static constexpr int MAX_EXTRA_INSTANCES = 10000;
+    std::vector<util::Entity> extraInstances;
+    int numExtraInstances{0};
+
+    // for picking, the top level is over instances
+    MeshBVH meshBVH;
+    SceneBVH sceneBVH;
+    std::vector<SceneBVH::Instance> bvhInstances;
+    std::vector<util::Entity> bvhEntities; // entity of each of bvhInstances
+    bool hasPickHit{false};
+    RayHit pickHit{};
+    util::Entity pickedEntity;
+
+    // (squared distance to camera, entity) of visible instances
+    std::vector<std::pair<float, util::Entity>> drawOrder;
+
+    static constexpr std::size_t MAX_OCCLUDERS = 4;
+    OcclusionCuller occlusionCuller;
+    bool useOcclusionCulling{true};
+    bool showOcclusionBuffer{false};
+    std::size_t numOccludedInstances{0};
+
+    util::TaskScheduler taskScheduler;
+    util::AssetStreamer assetStreamer;
+
+    bool useRenderThread{false};
+    std::thread renderThread;
+    std::atomic<bool> isRenderThreadRunning{false};
+    util::TripleBuffer<FramePacket> framePackets;
+    std::uint64_t numPublishedPackets{0};
 };
@@ -0,0 +1,94 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <Graphics/Skeleton.h>
+
+namespace
+{
+struct KeyframeSample {
+    std::size_t k0;
+    std::size_t k1;
+    float t;
+};
+
+KeyframeSample findKeyframes(const AnimationTrack& track, float time)
+{
+    const auto& times = track.times;
+    assert(!times.empty());
+    if (time <= times.front() || times.size() == 1) {
+        return {0, 0, 0.f};
+    }
+    if (time >= times.back()) {
+        return {times.size() - 1, times.size() - 1, 0.f};
+    }
+
+    const auto it = std::upper_bound(times.begin(), times.end(), time);
+    const auto k1 = static_cast<std::size_t>(it - times.begin());
+    const auto k0 = k1 - 1;
+    if (track.step) {
+        return {k0, k0, 0.f};
+    }
+    return {k0, k1, (time - times[k0]) / (times[k1] - times[k0])};
+}
+
+void sampleVec3(
+    const AnimationTrack& track,
+    const KeyframeSample& s,
+    float& x,
+    float& y,
+    float& z)
+{
+    const float* v0 = &track.values[s.k0 * 3];
+    const float* v1 = &track.values[s.k1 * 3];
+    x = v0[0] + (v1[0] - v0[0]) * s.t;
+    y = v0[1] + (v1[1] - v0[1]) * s.t;
+    z = v0[2] + (v1[2] - v0[2]) * s.t;
+}
+
+void sampleQuat(
+    const AnimationTrack& track,
+    const KeyframeSample& s,
+    float& x,
+    float& y,
+    float& z,
+    float& w)
+{
+    const float* q0 = &track.values[s.k0 * 4];
+    const float* q1 = &track.values[s.k1 * 4];
+    const float d = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+    const float t1 = d < 0.f ? -s.t : s.t;
+    const float t0 = 1.f - s.t;
+    x = q0[0] * t0 + q1[0] * t1;
+    y = q0[1] * t0 + q1[1] * t1;
+    z = q0[2] * t0 + q1[2] * t1;
+    w = q0[3] * t0 + q1[3] * t1;
+    const float invLen = 1.f / std::sqrt(x * x + y * y + z * z + w * w);
+    x *= invLen;
+    y *= invLen;
+    z *= invLen;
+    w *= invLen;
+}
+}
+
+void AnimationClip::sample(float time, SkeletonPose& pose) const
+{
+    for (const auto& track : tracks) {
+        const auto j = track.joint;
+        assert(j < pose.size());
+        const auto s = findKeyframes(track, time);
+        switch (track.path) {
+        case AnimationTrack::Path::Translation:
+            sampleVec3(track, s, pose.tx[j], pose.ty[j], pose.tz[j]);
+            break;
+        case AnimationTrack::Path::Rotation:
+            sampleQuat(track, s, pose.rx[j], pose.ry[j], pose.rz[j], pose.rw[j]);
+            break;
+        case AnimationTrack::Path::Scale:
+            sampleVec3(track, s, pose.sx[j], pose.sy[j], pose.sz[j]);
+            break;
+        }
+    }
+}
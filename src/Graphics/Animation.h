@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SkeletonPose;
+
+struct AnimationTrack {
+    enum class Path : std::uint8_t {
+        Translation,
+        Rotation,
+        Scale,
+    };
+
+    std::uint16_t joint{0};
+    Path path{Path::Translation};
+    bool step{false}; // STEP interpolation instead of linear
+
+    std::vector<float> times;
+    // 3 floats per key for translation/scale, 4 for rotation (x, y, z, w)
+    std::vector<float> values;
+};
+
+struct AnimationClip {
+    // Writes sampled values into the pose. Joints which are not animated
+    // by the clip are left unchanged, so the pose should be initialized
+    // with the rest pose first.
+    void sample(float time, SkeletonPose& pose) const;
+
+    std::string name;
+    float duration{0.f};
+    std::vector<AnimationTrack> tracks;
+};
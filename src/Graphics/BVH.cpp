@@ -0,0 +1,321 @@
+#include "BVH.h"
+
+#include <numeric>
+
+#include <util/TaskScheduler.h>
+
+namespace
+{
+constexpr std::size_t NUM_BINS = 16;
+constexpr std::uint32_t MAX_LEAF_SIZE = 4;
+// cost of visiting a node relative to intersecting a primitive
+constexpr float TRAVERSAL_COST = 1.f;
+
+// nodes with more primitives are binned in parallel (when built with a scheduler)...
+constexpr std::size_t PARALLEL_BINNING_THRESHOLD = 64 * 1024;
+constexpr std::size_t BINNING_GRAIN_SIZE = 16 * 1024;
+// ...and smaller ones become subtrees which are built in parallel
+constexpr std::size_t SUBTREE_SIZE = 4 * 1024;
+
+struct Bin {
+    AABB bounds;
+    std::uint32_t count{0};
+};
+
+// bins for each axis
+using Bins = std::array<std::array<Bin, NUM_BINS>, 3>;
+
+struct BinMapping {
+    glm::vec3 min;
+    glm::vec3 scale; // NUM_BINS / extent, 0 for flat axes
+
+    std::size_t getBin(const glm::vec3& centroid, int axis) const
+    {
+        const auto bin = static_cast<std::size_t>((centroid[axis] - min[axis]) * scale[axis]);
+        return std::min(bin, NUM_BINS - 1);
+    }
+};
+
+struct NodeBounds {
+    AABB bounds;
+    AABB centroidBounds;
+};
+
+struct Split {
+    int axis{-1};
+    std::size_t bin{0}; // primitives in bins < bin go to the left child
+    float cost{std::numeric_limits<float>::max()};
+};
+
+} // end of anonymous namespace
+
+struct BVH::BuildState {
+    std::span<const AABB> bounds;
+    std::vector<glm::vec3> centroids;
+    std::vector<std::uint32_t>& primitives;
+    util::TaskScheduler* scheduler;
+
+    // Runs f(begin, end) over primitives[first, first + count) and merges the results,
+    // in parallel for large ranges
+    template<typename T, typename F, typename Merge>
+    T reduce(std::uint32_t first, std::uint32_t count, F&& f, Merge&& merge) const
+    {
+        if (!scheduler || count < PARALLEL_BINNING_THRESHOLD) {
+            return f(first, first + count);
+        }
+        const auto numChunks = (count + BINNING_GRAIN_SIZE - 1) / BINNING_GRAIN_SIZE;
+        std::vector<T> results(numChunks);
+        scheduler->parallelFor(
+            count, BINNING_GRAIN_SIZE, [&](std::size_t begin, std::size_t end) {
+                results[begin / BINNING_GRAIN_SIZE] = f(first + begin, first + end);
+            });
+        for (std::size_t i = 1; i < numChunks; ++i) {
+            merge(results[0], results[i]);
+        }
+        return results[0];
+    }
+
+    NodeBounds computeBounds(std::uint32_t first, std::uint32_t count) const
+    {
+        return reduce<NodeBounds>(
+            first,
+            count,
+            [this](std::size_t begin, std::size_t end) {
+                NodeBounds b;
+                for (auto i = begin; i < end; ++i) {
+                    const auto p = primitives[i];
+                    b.bounds.grow(bounds[p]);
+                    b.centroidBounds.grow(centroids[p]);
+                }
+                return b;
+            },
+            [](NodeBounds& a, const NodeBounds& b) {
+                a.bounds.grow(b.bounds);
+                a.centroidBounds.grow(b.centroidBounds);
+            });
+    }
+
+    Split findSplit(std::uint32_t first, std::uint32_t count, const BinMapping& mapping) const
+    {
+        const auto allBins = reduce<Bins>(
+            first,
+            count,
+            [this, &mapping](std::size_t begin, std::size_t end) {
+                Bins bins{};
+                for (auto i = begin; i < end; ++i) {
+                    const auto p = primitives[i];
+                    for (int axis = 0; axis < 3; ++axis) {
+                        auto& bin = bins[axis][mapping.getBin(centroids[p], axis)];
+                        bin.bounds.grow(bounds[p]);
+                        ++bin.count;
+                    }
+                }
+                return bins;
+            },
+            [](Bins& a, const Bins& b) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    for (std::size_t i = 0; i < NUM_BINS; ++i) {
+                        a[axis][i].bounds.grow(b[axis][i].bounds);
+                        a[axis][i].count += b[axis][i].count;
+                    }
+                }
+            });
+
+        Split best;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (mapping.scale[axis] == 0.f) {
+                continue;
+            }
+            const auto& bins = allBins[axis];
+
+            // areas and counts on the left side of each plane between bins
+            std::array<float, NUM_BINS> leftArea{};
+            std::array<std::uint32_t, NUM_BINS> leftCount{};
+            AABB left;
+            std::uint32_t numLeft = 0;
+            for (std::size_t i = 1; i < NUM_BINS; ++i) {
+                left.grow(bins[i - 1].bounds);
+                numLeft += bins[i - 1].count;
+                leftArea[i] = left.getSurfaceArea();
+                leftCount[i] = numLeft;
+            }
+
+            AABB right;
+            std::uint32_t numRight = 0;
+            for (std::size_t i = NUM_BINS - 1; i > 0; --i) {
+                right.grow(bins[i].bounds);
+                numRight += bins[i].count;
+                if (leftCount[i] == 0 || numRight == 0) {
+                    continue;
+                }
+                const auto cost = leftCount[i] * leftArea[i] + numRight * right.getSurfaceArea();
+                if (cost < best.cost) {
+                    best = Split{.axis = axis, .bin = i, .cost = cost};
+                }
+            }
+        }
+        return best;
+    }
+
+    // Computes the node's bounds and splits it in two if it's worth it.
+    // Returns false for leaves.
+    bool splitNode(std::vector<Node>& nodes, std::uint32_t index, std::size_t depth) const
+    {
+        const auto first = nodes[index].leftFirst;
+        const auto count = nodes[index].count;
+        const auto b = computeBounds(first, count);
+        nodes[index].min = b.bounds.min;
+        nodes[index].max = b.bounds.max;
+        if (count <= 1 || depth + 1 >= MAX_DEPTH) {
+            return false;
+        }
+
+        const auto extent = b.centroidBounds.max - b.centroidBounds.min;
+        BinMapping mapping{.min = b.centroidBounds.min, .scale = {}};
+        for (int axis = 0; axis < 3; ++axis) {
+            mapping.scale[axis] = extent[axis] > 0.f ? NUM_BINS / extent[axis] : 0.f;
+        }
+
+        const auto split = findSplit(first, count, mapping);
+        std::uint32_t numLeft = 0;
+        if (split.axis >= 0) {
+            const auto area = b.bounds.getSurfaceArea();
+            const auto splitCost = area > 0.f ? TRAVERSAL_COST + split.cost / area : count;
+            if (count <= MAX_LEAF_SIZE && splitCost >= count) {
+                return false;
+            }
+            const auto begin = primitives.begin() + first;
+            const auto middle = std::partition(begin, begin + count, [&](std::uint32_t p) {
+                return mapping.getBin(centroids[p], split.axis) < split.bin;
+            });
+            numLeft = static_cast<std::uint32_t>(middle - begin);
+        } else if (count > MAX_LEAF_SIZE) {
+            // all centroids are in the same place - just cut the range in half
+            numLeft = count / 2;
+        } else {
+            return false;
+        }
+        assert(numLeft > 0 && numLeft < count);
+
+        const auto leftIndex = static_cast<std::uint32_t>(nodes.size());
+        nodes[index].leftFirst = leftIndex;
+        nodes[index].count = 0;
+        nodes.push_back(Node{.min = {}, .leftFirst = first, .max = {}, .count = numLeft});
+        nodes.push_back(
+            Node{.min = {}, .leftFirst = first + numLeft, .max = {}, .count = count - numLeft});
+        return true;
+    }
+
+    void buildSubtree(std::vector<Node>& nodes, std::uint32_t root, std::size_t rootDepth) const
+    {
+        std::vector<std::pair<std::uint32_t, std::size_t>> stack{{root, rootDepth}};
+        while (!stack.empty()) {
+            const auto [index, depth] = stack.back();
+            stack.pop_back();
+            if (splitNode(nodes, index, depth)) {
+                const auto left = nodes[index].leftFirst;
+                stack.emplace_back(left + 1, depth + 1);
+                stack.emplace_back(left, depth + 1);
+            }
+        }
+    }
+};
+
+void RayPacket::set(std::size_t lane, const Ray& ray)
+{
+    assert(lane < SIZE);
+    originX[lane] = ray.origin.x;
+    originY[lane] = ray.origin.y;
+    originZ[lane] = ray.origin.z;
+    dirX[lane] = ray.direction.x;
+    dirY[lane] = ray.direction.y;
+    dirZ[lane] = ray.direction.z;
+    maxDistance[lane] = ray.maxDistance;
+}
+
+void BVH::build(std::span<const AABB> bounds, util::TaskScheduler* scheduler)
+{
+    nodes.clear();
+    primitives.resize(bounds.size());
+    std::iota(primitives.begin(), primitives.end(), 0);
+    if (bounds.empty()) {
+        return;
+    }
+
+    BuildState state{
+        .bounds = bounds,
+        .centroids = std::vector<glm::vec3>(bounds.size()),
+        .primitives = primitives,
+        .scheduler = scheduler,
+    };
+    const auto computeCentroids = [&state](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            state.centroids[i] = state.bounds[i].getCenter();
+        }
+    };
+    if (scheduler) {
+        scheduler->parallelFor(bounds.size(), BINNING_GRAIN_SIZE, computeCentroids);
+    } else {
+        computeCentroids(0, bounds.size());
+    }
+
+    // the worst case is one leaf per primitive
+    nodes.reserve(bounds.size() * 2 - 1);
+    const auto numPrimitives = static_cast<std::uint32_t>(bounds.size());
+    nodes.push_back(Node{.min = {}, .leftFirst = 0, .max = {}, .count = numPrimitives});
+    if (!scheduler || scheduler->getNumWorkers() == 0) {
+        state.buildSubtree(nodes, 0, 0);
+        return;
+    }
+
+    // split the top of the tree here, collecting roots of small enough subtrees
+    struct Subtree {
+        std::uint32_t root;
+        std::size_t depth;
+        std::vector<Node> nodes;
+    };
+    std::vector<Subtree> subtrees;
+    std::vector<std::pair<std::uint32_t, std::size_t>> stack{{0, 0}};
+    while (!stack.empty()) {
+        const auto [index, depth] = stack.back();
+        stack.pop_back();
+        if (nodes[index].count <= SUBTREE_SIZE) {
+            subtrees.push_back(Subtree{.root = index, .depth = depth, .nodes = {nodes[index]}});
+            continue;
+        }
+        if (state.splitNode(nodes, index, depth)) {
+            const auto left = nodes[index].leftFirst;
+            stack.emplace_back(left + 1, depth + 1);
+            stack.emplace_back(left, depth + 1);
+        }
+    }
+
+    // subtrees work on disjoint ranges of primitives, so they don't need to synchronize
+    scheduler->parallelFor(
+        subtrees.size(), 1, [&state, &subtrees](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                state.buildSubtree(subtrees[i].nodes, 0, subtrees[i].depth);
+            }
+        });
+
+    // Append subtrees to the node array. Their roots replace the placeholders they were
+    // created from, so local index i > 0 becomes offset + i - 1.
+    for (auto& subtree : subtrees) {
+        const auto offset = static_cast<std::uint32_t>(nodes.size());
+        for (auto& node : subtree.nodes) {
+            if (!node.isLeaf()) {
+                node.leftFirst = offset + node.leftFirst - 1;
+            }
+        }
+        nodes[subtree.root] = subtree.nodes[0];
+        nodes.insert(nodes.end(), subtree.nodes.begin() + 1, subtree.nodes.end());
+    }
+}
+
+AABB BVH::getBounds() const
+{
+    if (nodes.empty()) {
+        return {};
+    }
+    return AABB{.min = nodes[0].min, .max = nodes[0].max};
+}
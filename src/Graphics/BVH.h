@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <util/Float4.h>
+
+#include <glm/common.hpp>
+#include <glm/vec3.hpp>
+
+namespace util
+{
+class TaskScheduler;
+}
+
+struct AABB {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{-std::numeric_limits<float>::max()};
+
+    void grow(const glm::vec3& p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void grow(const AABB& b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    bool isEmpty() const { return min.x > max.x; }
+    glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+
+    float getSurfaceArea() const
+    {
+        if (isEmpty()) {
+            return 0.f;
+        }
+        const auto e = max - min;
+        return 2.f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    bool overlaps(const AABB& b) const
+    {
+        return min.x <= b.max.x && max.x >= b.min.x && min.y <= b.max.y && max.y >= b.min.y &&
+               min.z <= b.max.z && max.z >= b.min.z;
+    }
+};
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction; // doesn't have to be normalized, distances are in its units
+    float maxDistance{std::numeric_limits<float>::max()};
+};
+
+// Rays traversed together, stored as SoA so that all lanes are tested against a node
+// or a triangle with a few SIMD instructions (util::Float4).
+// Works best for coherent rays, e.g. neighbouring pixels.
+struct RayPacket {
+    static constexpr std::size_t SIZE = 4;
+
+    std::array<float, SIZE> originX, originY, originZ;
+    std::array<float, SIZE> dirX, dirY, dirZ;
+    std::array<float, SIZE> maxDistance;
+
+    void set(std::size_t lane, const Ray& ray);
+};
+
+struct RayHit {
+    float distance; // along the ray's direction
+    std::uint32_t triangle; // index of the triangle in the mesh
+    std::uint32_t instance{0}; // only set by SceneBVH
+    float u, v; // barycentric coordinates of the hit point (relative to the 2nd and 3rd vertex)
+};
+
+// Bounding volume hierarchy over boxes, built top-down with binned SAH.
+// Nodes are stored in one array and siblings are next to each other, so that
+// a node needs a single index for both of its children.
+class BVH {
+public:
+    struct Node {
+        glm::vec3 min;
+        std::uint32_t leftFirst; // first primitive for leaves, left child otherwise
+        glm::vec3 max;
+        std::uint32_t count; // number of primitives, 0 for inner nodes
+
+        bool isLeaf() const { return count != 0; }
+    };
+
+    static constexpr std::size_t MAX_DEPTH = 64;
+
+    // Primitives are referred to by their index in bounds. With a scheduler the top
+    // of the tree is split with parallel binning and subtrees are built in parallel.
+    void build(std::span<const AABB> bounds, util::TaskScheduler* scheduler = nullptr);
+
+    bool isEmpty() const { return nodes.empty(); }
+    const std::vector<Node>& getNodes() const { return nodes; }
+    // leaves refer to primitives[leftFirst, leftFirst + count)
+    const std::vector<std::uint32_t>& getPrimitives() const { return primitives; }
+    AABB getBounds() const;
+
+    // Calls onLeaf(first, count, maxDistance) for leaves the ray hits, closer nodes
+    // first. onLeaf can shorten maxDistance (e.g. to the closest hit so far) to skip
+    // nodes behind it and return true to stop traversal.
+    template<typename F>
+    void traverseRay(const Ray& ray, F&& onLeaf) const;
+
+    // Calls onLeaf(first, count, laneMask, maxDistances) for leaves hit by at least one
+    // of the lanes in laneMask, onLeaf can shorten maxDistances like in traverseRay.
+    template<typename F>
+    void traverseRayPacket(const RayPacket& rays, std::uint32_t laneMask, F&& onLeaf) const;
+
+    // Calls onLeaf(first, count) for leaves for which overlapsNode(min, max) is true,
+    // onLeaf returns true to stop traversal.
+    template<typename OverlapFunc, typename F>
+    void traverse(OverlapFunc&& overlapsNode, F&& onLeaf) const;
+
+private:
+    struct BuildState;
+
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> primitives;
+};
+
+template<typename F>
+void BVH::traverseRay(const Ray& ray, F&& onLeaf) const
+{
+    if (nodes.empty()) {
+        return;
+    }
+
+    const auto invDir = 1.f / ray.direction;
+    float maxDistance = ray.maxDistance;
+    // returns the distance at which the ray enters the box or infinity if it misses
+    const auto intersect = [&](const Node& node) {
+        const auto t1 = (node.min - ray.origin) * invDir;
+        const auto t2 = (node.max - ray.origin) * invDir;
+        const auto tNear = glm::min(t1, t2);
+        const auto tFar = glm::max(t1, t2);
+        const auto tEnter = std::max({tNear.x, tNear.y, tNear.z, 0.f});
+        const auto tExit = std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+        return tEnter <= tExit ? tEnter : std::numeric_limits<float>::infinity();
+    };
+
+    if (intersect(nodes[0]) == std::numeric_limits<float>::infinity()) {
+        return;
+    }
+
+    // the stack stores entry distances too, maxDistance can shrink after a node is pushed
+    std::array<std::pair<std::uint32_t, float>, MAX_DEPTH> stack;
+    std::size_t stackSize = 0;
+    std::uint32_t current = 0;
+    while (true) {
+        const auto& node = nodes[current];
+        if (node.isLeaf()) {
+            if (onLeaf(node.leftFirst, node.count, maxDistance)) {
+                return;
+            }
+        } else {
+            auto nearChild = node.leftFirst;
+            auto farChild = node.leftFirst + 1;
+            auto tNear = intersect(nodes[nearChild]);
+            auto tFar = intersect(nodes[farChild]);
+            if (tFar < tNear) {
+                std::swap(nearChild, farChild);
+                std::swap(tNear, tFar);
+            }
+            if (tNear != std::numeric_limits<float>::infinity()) {
+                if (tFar != std::numeric_limits<float>::infinity()) {
+                    assert(stackSize < stack.size());
+                    stack[stackSize++] = {farChild, tFar};
+                }
+                current = nearChild;
+                continue;
+            }
+        }
+
+        // pop the next node which is still closer than the closest hit
+        do {
+            if (stackSize == 0) {
+                return;
+            }
+            const auto [index, t] = stack[--stackSize];
+            current = index;
+            if (t <= maxDistance) {
+                break;
+            }
+        } while (true);
+    }
+}
+
+template<typename F>
+void BVH::traverseRayPacket(const RayPacket& rays, std::uint32_t laneMask, F&& onLeaf) const
+{
+    constexpr auto N = RayPacket::SIZE;
+    if (nodes.empty() || laneMask == 0) {
+        return;
+    }
+
+    static_assert(N == 4, "lanes are processed with util::Float4");
+    using util::Float4;
+
+    std::array<float, N> maxDistance = rays.maxDistance;
+    const auto one = Float4::broadcast(1.f);
+    const auto zero = Float4::broadcast(0.f);
+    const auto originX = Float4::load(rays.originX.data());
+    const auto originY = Float4::load(rays.originY.data());
+    const auto originZ = Float4::load(rays.originZ.data());
+    const auto invDirX = one / Float4::load(rays.dirX.data());
+    const auto invDirY = one / Float4::load(rays.dirY.data());
+    const auto invDirZ = one / Float4::load(rays.dirZ.data());
+
+    // returns the mask of lanes which hit the node
+    const auto intersect = [&](const Node& node) {
+        const auto tx1 = (Float4::broadcast(node.min.x) - originX) * invDirX;
+        const auto tx2 = (Float4::broadcast(node.max.x) - originX) * invDirX;
+        const auto ty1 = (Float4::broadcast(node.min.y) - originY) * invDirY;
+        const auto ty2 = (Float4::broadcast(node.max.y) - originY) * invDirY;
+        const auto tz1 = (Float4::broadcast(node.min.z) - originZ) * invDirZ;
+        const auto tz2 = (Float4::broadcast(node.max.z) - originZ) * invDirZ;
+        const auto tEnter = max(max(min(tx1, tx2), min(ty1, ty2)), max(min(tz1, tz2), zero));
+        // onLeaf can change maxDistance between calls
+        const auto tExit = min(
+            min(max(tx1, tx2), max(ty1, ty2)),
+            min(max(tz1, tz2), Float4::load(maxDistance.data())));
+        return (tEnter <= tExit).getBits();
+    };
+
+    std::array<std::uint32_t, MAX_DEPTH> stack;
+    std::size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize != 0) {
+        const auto& node = nodes[stack[--stackSize]];
+        const auto mask = intersect(node) & laneMask;
+        if (mask == 0) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            if (onLeaf(node.leftFirst, node.count, mask, maxDistance)) {
+                return;
+            }
+            continue;
+        }
+        // visit the child closer to the first active ray first
+        // (compared along the ray's dominant axis)
+        const auto lane = static_cast<std::size_t>(std::countr_zero(mask));
+        const glm::vec3 dir{rays.dirX[lane], rays.dirY[lane], rays.dirZ[lane]};
+        const auto absDir = glm::abs(dir);
+        const int axis = absDir.x >= absDir.y && absDir.x >= absDir.z ? 0 :
+                         absDir.y >= absDir.z                         ? 1 :
+                                                                        2;
+        const auto& left = nodes[node.leftFirst];
+        const auto& right = nodes[node.leftFirst + 1];
+        const bool isLeftCloser = dir[axis] >= 0.f ? left.min[axis] <= right.min[axis] :
+                                                     left.max[axis] >= right.max[axis];
+        assert(stackSize + 2 <= stack.size());
+        stack[stackSize++] = isLeftCloser ? node.leftFirst + 1 : node.leftFirst;
+        stack[stackSize++] = isLeftCloser ? node.leftFirst : node.leftFirst + 1;
+    }
+}
+
+template<typename OverlapFunc, typename F>
+void BVH::traverse(OverlapFunc&& overlapsNode, F&& onLeaf) const
+{
+    if (nodes.empty()) {
+        return;
+    }
+
+    std::array<std::uint32_t, MAX_DEPTH> stack;
+    std::size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize != 0) {
+        const auto& node = nodes[stack[--stackSize]];
+        if (!overlapsNode(node.min, node.max)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            if (onLeaf(node.leftFirst, node.count)) {
+                return;
+            }
+            continue;
+        }
+        assert(stackSize + 2 <= stack.size());
+        stack[stackSize++] = node.leftFirst + 1;
+        stack[stackSize++] = node.leftFirst;
+    }
+}
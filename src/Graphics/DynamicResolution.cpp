@@ -0,0 +1,78 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr float SMOOTHING = 0.1f;
+
+// a bit of slack, frame intervals jitter
+constexpr float OVER_BUDGET = 1.1f;
+constexpr int FRAMES_TO_DOWNSCALE = 10;
+
+// predicted GPU time at the next scale should leave some headroom
+constexpr float UNDER_BUDGET = 0.85f;
+constexpr int FRAMES_TO_UPSCALE = 60;
+
+constexpr int MIN_PROBE_DELAY = 180;
+constexpr int MAX_PROBE_DELAY = 60 * 60;
+// a probe failed if the scale goes down again this soon
+constexpr int PROBE_FAIL_FRAMES = 60;
+} // end of anonymous namespace
+
+DynamicResolution::DynamicResolution(float targetFrameTime) :
+    targetFrameTime(targetFrameTime),
+    smoothedFrameTime(targetFrameTime),
+    probeDelay(MIN_PROBE_DELAY)
+{}
+
+void DynamicResolution::update(float frameTime, bool isGPUTime)
+{
+    smoothedFrameTime += (frameTime - smoothedFrameTime) * SMOOTHING;
+    if (framesSinceProbe >= 0 && ++framesSinceProbe == PROBE_FAIL_FRAMES) {
+        // the probe succeeded
+        probeDelay = MIN_PROBE_DELAY;
+        framesSinceProbe = -1;
+    }
+
+    if (smoothedFrameTime > targetFrameTime * OVER_BUDGET) {
+        framesUnderBudget = 0;
+        if (++framesOverBudget >= FRAMES_TO_DOWNSCALE && level > 0) {
+            if (framesSinceProbe >= 0) { // the probe failed
+                probeDelay = std::min(probeDelay * 2, MAX_PROBE_DELAY);
+            }
+            changeLevel(level - 1);
+            framesSinceProbe = -1;
+        }
+        return;
+    }
+
+    framesOverBudget = 0;
+    if (level + 1 == SCALES.size()) {
+        return;
+    }
+
+    bool canUpscale = true;
+    int framesNeeded = probeDelay;
+    if (isGPUTime) {
+        const auto nextScale = SCALES[level + 1];
+        const auto pixelRatio = (nextScale * nextScale) / (getScale() * getScale());
+        canUpscale = smoothedFrameTime * pixelRatio < targetFrameTime * UNDER_BUDGET;
+        framesNeeded = FRAMES_TO_UPSCALE;
+    }
+
+    framesUnderBudget = canUpscale ? framesUnderBudget + 1 : 0;
+    if (framesUnderBudget >= framesNeeded) {
+        changeLevel(level + 1);
+        framesSinceProbe = isGPUTime ? -1 : 0;
+    }
+}
+
+void DynamicResolution::changeLevel(std::size_t newLevel)
+{
+    level = newLevel;
+    framesOverBudget = 0;
+    framesUnderBudget = 0;
+    // frame times measured at the old scale don't say much about the new one
+    smoothedFrameTime = std::min(smoothedFrameTime, targetFrameTime);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// Picks the render scale from measured frame times to hold the target frame rate.
+// Scales come from a small fixed set and only change after the frame time has been
+// over or under budget for a while, so the resolution doesn't oscillate.
+//
+// With GPU times the cost of the next scale up can be predicted (it's proportional
+// to the number of pixels). Frame intervals (the web) can't tell how much headroom
+// there is, so a higher scale is tried after a while and the wait gets longer
+// every time it fails.
+class DynamicResolution {
+public:
+    static constexpr std::array<float, 5> SCALES = {0.5f, 0.625f, 0.75f, 0.875f, 1.f};
+
+    explicit DynamicResolution(float targetFrameTime);
+
+    // frameTime is in seconds
+    void update(float frameTime, bool isGPUTime);
+
+    float getScale() const { return SCALES[level]; }
+    float getSmoothedFrameTime() const { return smoothedFrameTime; }
+
+private:
+    void changeLevel(std::size_t newLevel);
+
+    float targetFrameTime;
+    float smoothedFrameTime;
+
+    std::size_t level{SCALES.size() - 1};
+    int framesOverBudget{0};
+    int framesUnderBudget{0};
+
+    // only for frame intervals
+    int probeDelay;
+    int framesSinceProbe{-1}; // -1 if no probe is being checked
+};
@@ -0,0 +1,27 @@
+#include "FramePacket.h"
+
+ImGuiDrawDataCopy::~ImGuiDrawDataCopy()
+{
+    clear();
+}
+
+void ImGuiDrawDataCopy::copyFrom(const ImDrawData& src)
+{
+    clear();
+
+    // copy display params, draw lists are cloned below
+    drawData = src;
+    drawData.CmdLists.resize(0);
+    for (int i = 0; i < src.CmdLists.Size; ++i) {
+        drawData.CmdLists.push_back(src.CmdLists[i]->CloneOutput());
+    }
+}
+
+void ImGuiDrawDataCopy::clear()
+{
+    for (int i = 0; i < drawData.CmdLists.Size; ++i) {
+        IM_DELETE(drawData.CmdLists[i]);
+    }
+    drawData.CmdLists.clear();
+    drawData.Valid = false;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Graphics/RenderTarget.h>
+
+#include <glm/mat4x4.hpp>
+
+#include <imgui.h>
+
+// Owning copy of ImGui draw data which can be rendered on another thread
+// while the next ImGui frame is being built
+class ImGuiDrawDataCopy {
+public:
+    ImGuiDrawDataCopy() = default;
+    ~ImGuiDrawDataCopy();
+
+    ImGuiDrawDataCopy(const ImGuiDrawDataCopy&) = delete;
+    ImGuiDrawDataCopy& operator=(const ImGuiDrawDataCopy&) = delete;
+
+    void copyFrom(const ImDrawData& src);
+    ImDrawData* get() { return drawData.Valid ? &drawData : nullptr; }
+
+private:
+    void clear();
+
+    ImDrawData drawData;
+};
+
+// Everything the renderer needs to draw a frame. Built by the simulation,
+// so that the renderer doesn't touch game state.
+struct FramePacket {
+    struct DrawItem {
+        std::uint32_t vao;
+        std::uint32_t texture;
+        std::uint32_t numIndices;
+        glm::mat4 transform;
+        // range in jointMatrices, numJoints is 0 for non-skinned meshes
+        std::uint32_t jointOffset{0};
+        std::uint32_t numJoints{0};
+    };
+
+    int screenWidth{0};
+    int screenHeight{0};
+
+    ScaleMode scaleMode{ScaleMode::Fit};
+    UpscaleFilter upscaleFilter{UpscaleFilter::SharpBilinear};
+    float renderScale{1.f};
+    bool depthPrepass{false};
+    bool showOverdraw{false};
+
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 vp;
+    float time{0.f}; // seconds
+    // opaque, sorted front to back
+    std::vector<DrawItem> drawItems;
+    std::vector<glm::mat4> jointMatrices;
+
+    // only filled when rendering on a separate thread
+    ImGuiDrawDataCopy imguiDrawData;
+    // number of packets published before this one, see setGLDeletionFrame
+    std::uint64_t frameIndex{0};
+};
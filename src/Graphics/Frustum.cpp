@@ -0,0 +1,53 @@
+#include "Frustum.h"
+
+#include <glm/geometric.hpp>
+
+Frustum Frustum::fromMatrix(const glm::mat4& vp)
+{
+    // Gribb & Hartmann plane extraction (glm matrices are column-major)
+    const auto row = [&vp](int i) { return glm::vec4{vp[0][i], vp[1][i], vp[2][i], vp[3][i]}; };
+    const auto r0 = row(0);
+    const auto r1 = row(1);
+    const auto r2 = row(2);
+    const auto r3 = row(3);
+
+    Frustum f;
+    f.planes = {
+        r3 + r0, // left
+        r3 - r0, // right
+        r3 + r1, // bottom
+        r3 - r1, // top
+        r3 + r2, // near
+        r3 - r2, // far
+    };
+    for (auto& p : f.planes) {
+        p /= glm::length(glm::vec3{p});
+    }
+    return f;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+    for (const auto& p : planes) {
+        if (glm::dot(glm::vec3{p}, center) + p.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectsAABB(const glm::vec3& min, const glm::vec3& max) const
+{
+    for (const auto& p : planes) {
+        // the corner which is the furthest along the plane normal
+        const glm::vec3 v{
+            p.x >= 0.f ? max.x : min.x,
+            p.y >= 0.f ? max.y : min.y,
+            p.z >= 0.f ? max.z : min.z,
+        };
+        if (glm::dot(glm::vec3{p}, v) + p.w < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <array>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+struct Frustum {
+    // planes are stored as (normal, d) with normals pointing inside
+    std::array<glm::vec4, 6> planes;
+
+    static Frustum fromMatrix(const glm::mat4& vp);
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+    bool intersectsAABB(const glm::vec3& min, const glm::vec3& max) const;
+};
@@ -0,0 +1,140 @@
+#include "GLHandle.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+#include <Platform/gl.h>
+
+namespace
+{
+constexpr std::size_t NUM_RESOURCE_TYPES = static_cast<std::size_t>(GLResourceType::Query) + 1;
+
+struct DeletionQueue {
+    struct Entry {
+        GLuint id;
+        GLResourceType type;
+        std::uint64_t frame;
+    };
+
+    std::mutex mutex;
+    std::vector<Entry> entries; // sorted by frame
+    std::uint64_t frame{0};
+};
+
+DeletionQueue& getDeletionQueue()
+{
+    static DeletionQueue queue;
+    return queue;
+}
+
+void deleteResources(GLResourceType type, const std::vector<GLuint>& ids)
+{
+    if (ids.empty()) {
+        return;
+    }
+
+    const auto count = static_cast<GLsizei>(ids.size());
+    switch (type) {
+    case GLResourceType::Buffer:
+        glDeleteBuffers(count, ids.data());
+        break;
+    case GLResourceType::VertexArray:
+        glDeleteVertexArrays(count, ids.data());
+        break;
+    case GLResourceType::Texture:
+        glDeleteTextures(count, ids.data());
+        break;
+    case GLResourceType::Sampler:
+        glDeleteSamplers(count, ids.data());
+        break;
+    case GLResourceType::Program:
+        for (const auto id : ids) {
+            glDeleteProgram(id);
+        }
+        break;
+    case GLResourceType::Framebuffer:
+        glDeleteFramebuffers(count, ids.data());
+        break;
+    case GLResourceType::Renderbuffer:
+        glDeleteRenderbuffers(count, ids.data());
+        break;
+    case GLResourceType::Query:
+        glDeleteQueries(count, ids.data());
+        break;
+    }
+}
+}
+
+std::uint32_t createGLResource(GLResourceType type)
+{
+    GLuint id{0};
+    switch (type) {
+    case GLResourceType::Buffer:
+        glGenBuffers(1, &id);
+        break;
+    case GLResourceType::VertexArray:
+        glGenVertexArrays(1, &id);
+        break;
+    case GLResourceType::Texture:
+        glGenTextures(1, &id);
+        break;
+    case GLResourceType::Sampler:
+        glGenSamplers(1, &id);
+        break;
+    case GLResourceType::Program:
+        id = glCreateProgram();
+        break;
+    case GLResourceType::Framebuffer:
+        glGenFramebuffers(1, &id);
+        break;
+    case GLResourceType::Renderbuffer:
+        glGenRenderbuffers(1, &id);
+        break;
+    case GLResourceType::Query:
+        glGenQueries(1, &id);
+        break;
+    }
+    assert(id != 0);
+    return id;
+}
+
+void queueGLResourceDeletion(GLResourceType type, std::uint32_t id)
+{
+    auto& queue = getDeletionQueue();
+    std::lock_guard lock(queue.mutex);
+    queue.entries.push_back({.id = id, .type = type, .frame = queue.frame});
+}
+
+void setGLDeletionFrame(std::uint64_t frame)
+{
+    auto& queue = getDeletionQueue();
+    std::lock_guard lock(queue.mutex);
+    assert(frame >= queue.frame);
+    queue.frame = frame;
+}
+
+void flushGLDeletionQueue(std::uint64_t drawnFrame)
+{
+    auto& queue = getDeletionQueue();
+
+    // take out the ids so that GL calls are not made under the lock
+    std::array<std::vector<GLuint>, NUM_RESOURCE_TYPES> ids;
+    {
+        std::lock_guard lock(queue.mutex);
+        const auto end = std::find_if(
+            queue.entries.begin(), queue.entries.end(), [drawnFrame](const auto& e) {
+                return e.frame > drawnFrame;
+            });
+        for (auto it = queue.entries.begin(); it != end; ++it) {
+            ids[static_cast<std::size_t>(it->type)].push_back(it->id);
+        }
+        queue.entries.erase(queue.entries.begin(), end);
+    }
+
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        deleteResources(static_cast<GLResourceType>(i), ids[i]);
+    }
+}
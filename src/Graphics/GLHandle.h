@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+enum class GLResourceType {
+    Buffer,
+    VertexArray,
+    Texture,
+    Sampler,
+    Program,
+    Framebuffer,
+    Renderbuffer,
+    Query,
+};
+
+// Creates a GL object of a given type (needs current GL context)
+std::uint32_t createGLResource(GLResourceType type);
+
+// GL objects are not deleted immediately - deleting objects which are still
+// used by in-flight draws can stall the driver. Deletions get queued
+// and are performed by flushGLDeletionQueue at the frame boundary.
+void queueGLResourceDeletion(GLResourceType type, std::uint32_t id);
+// Queued deletions are tagged with the index of the frame which is being built.
+// When frames are drawn on another thread, objects can still be used by frames
+// built before, so only the ones queued no later than drawnFrame get deleted.
+void setGLDeletionFrame(std::uint64_t frame);
+void flushGLDeletionQueue(
+    std::uint64_t drawnFrame = std::numeric_limits<std::uint64_t>::max());
+
+template<GLResourceType Type>
+class GLHandle {
+public:
+    GLHandle() = default;
+    explicit GLHandle(std::uint32_t id) : id(id) {}
+    ~GLHandle() { reset(); }
+
+    // move only
+    GLHandle(GLHandle&& o) noexcept : id(std::exchange(o.id, 0)) {}
+    GLHandle& operator=(GLHandle&& o) noexcept
+    {
+        if (this != &o) {
+            reset();
+            id = std::exchange(o.id, 0);
+        }
+        return *this;
+    }
+
+    // no copies
+    GLHandle(const GLHandle& o) = delete;
+    GLHandle& operator=(const GLHandle& o) = delete;
+
+    static GLHandle create() { return GLHandle(createGLResource(Type)); }
+
+    std::uint32_t get() const { return id; }
+    explicit operator bool() const { return id != 0; }
+
+    void reset()
+    {
+        if (id != 0) {
+            queueGLResourceDeletion(Type, id);
+            id = 0;
+        }
+    }
+
+    // gives up the ownership without deleting the object
+    std::uint32_t release() { return std::exchange(id, 0); }
+
+private:
+    std::uint32_t id{0};
+};
+
+using GLBuffer = GLHandle<GLResourceType::Buffer>;
+using GLVertexArray = GLHandle<GLResourceType::VertexArray>;
+using GLTexture = GLHandle<GLResourceType::Texture>;
+using GLSampler = GLHandle<GLResourceType::Sampler>;
+using GLProgram = GLHandle<GLResourceType::Program>;
+using GLFramebuffer = GLHandle<GLResourceType::Framebuffer>;
+using GLRenderbuffer = GLHandle<GLResourceType::Renderbuffer>;
+using GLQuery = GLHandle<GLResourceType::Query>;
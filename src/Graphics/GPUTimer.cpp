@@ -0,0 +1,56 @@
+#include "GPUTimer.h"
+
+#include <Platform/gl.h>
+
+void GPUTimer::init()
+{
+#ifndef __EMSCRIPTEN__
+    // timer queries are core since GL 3.3
+    supported = true;
+    for (auto& query : queries) {
+        query = GLQuery::create();
+    }
+#endif
+}
+
+void GPUTimer::begin()
+{
+#ifndef __EMSCRIPTEN__
+    if (!supported || numPending == NUM_QUERIES) {
+        return; // the GPU is far behind, skip measuring this frame
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries[writeIndex].get());
+    isMeasuring = true;
+#endif
+}
+
+void GPUTimer::end()
+{
+#ifndef __EMSCRIPTEN__
+    if (isMeasuring) {
+        glEndQuery(GL_TIME_ELAPSED);
+        isMeasuring = false;
+        writeIndex = (writeIndex + 1) % NUM_QUERIES;
+        ++numPending;
+    }
+    collectResults();
+#endif
+}
+
+void GPUTimer::collectResults()
+{
+#ifndef __EMSCRIPTEN__
+    while (numPending > 0) {
+        const auto& query = queries[(writeIndex + NUM_QUERIES - numPending) % NUM_QUERIES];
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(query.get(), GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            break;
+        }
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(query.get(), GL_QUERY_RESULT, &ns);
+        latest = static_cast<float>(ns) / 1'000'000'000.f;
+        --numPending;
+    }
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include <Graphics/GLHandle.h>
+
+// Measures how long the GPU takes to execute commands between begin() and end().
+// Results arrive a few frames later, the queries are never waited on.
+// WebGL doesn't reliably expose timer queries, so there it's never supported.
+class GPUTimer {
+public:
+    void init();
+    bool isSupported() const { return supported; }
+
+    void begin();
+    void end();
+
+    // returns the latest finished measurement in seconds or a negative value if there's none
+    float getLatest() const { return latest; }
+
+private:
+    void collectResults();
+
+    static constexpr std::size_t NUM_QUERIES = 4;
+
+    bool supported{false};
+    std::array<GLQuery, NUM_QUERIES> queries;
+    std::size_t writeIndex{0};
+    std::size_t numPending{0};
+    bool isMeasuring{false};
+    float latest{-1.f};
+};
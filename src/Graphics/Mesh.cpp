@@ -1,34 +1,37 @@
 #include "Mesh.h"
 
-#include <Platform/gl.h>
+#include <cassert>
 
-Mesh::~Mesh()
-{
-    glDeleteBuffers(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
-}
+#include <Platform/gl.h>
 
 void Mesh::initGeometry()
 {
+    assert(!vao && "geometry was already uploaded");
+    numVertices = data.vertices.size();
+    numIndices = data.indices.size();
+    skinned = !data.skinVertices.empty();
+
     // vao
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    vao = GLVertexArray::create();
+    glBindVertexArray(vao.get());
 
     // vbo
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    vbo = GLBuffer::create();
+    glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
 
     glBufferData(
-        GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+        GL_ARRAY_BUFFER,
+        sizeof(Vertex) * data.vertices.size(),
+        data.vertices.data(),
+        GL_STATIC_DRAW);
 
     // ebo
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    ebo = GLBuffer::create();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo.get());
     glBufferData(
         GL_ELEMENT_ARRAY_BUFFER,
-        sizeof(std::uint16_t) * indices.size(),
-        indices.data(),
+        sizeof(std::uint16_t) * data.indices.size(),
+        data.indices.data(),
         GL_STATIC_DRAW);
 
     // specify vertex layout
@@ -50,4 +53,54 @@ void Mesh::initGeometry()
     glVertexAttribPointer(
         3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
     glEnableVertexAttribArray(3);
+
+    if (skinned) {
+        assert(data.skinVertices.size() == data.vertices.size());
+        skinVbo = GLBuffer::create();
+        glBindBuffer(GL_ARRAY_BUFFER, skinVbo.get());
+        glBufferData(
+            GL_ARRAY_BUFFER,
+            sizeof(SkinVertex) * data.skinVertices.size(),
+            data.skinVertices.data(),
+            GL_STATIC_DRAW);
+
+        // joints
+        glVertexAttribIPointer(
+            4,
+            4,
+            GL_UNSIGNED_BYTE,
+            sizeof(SkinVertex),
+            (void*)offsetof(SkinVertex, joints));
+        glEnableVertexAttribArray(4);
+
+        // weights
+        glVertexAttribPointer(
+            5, 4, GL_FLOAT, GL_FALSE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, weights));
+        glEnableVertexAttribArray(5);
+    }
+
+    releaseCPUData();
+}
+
+void Mesh::releaseCPUData()
+{
+    switch (residency) {
+    case Residency::Keep:
+        break;
+    case Residency::Discard:
+        // swap with empty vectors - clear() doesn't free memory
+        std::vector<Vertex>().swap(data.vertices);
+        std::vector<std::uint16_t>().swap(data.indices);
+        std::vector<SkinVertex>().swap(data.skinVertices);
+        std::vector<glm::vec3>().swap(positions);
+        break;
+    case Residency::KeepPositionsAndIndices:
+        positions.resize(data.vertices.size());
+        for (std::size_t i = 0; i < data.vertices.size(); ++i) {
+            positions[i] = data.vertices[i].pos;
+        }
+        std::vector<Vertex>().swap(data.vertices);
+        std::vector<SkinVertex>().swap(data.skinVertices);
+        break;
+    }
 }
@@ -1,34 +1,45 @@
 #pragma once
 
 #include <cstdint>
-#include <string>
 #include <vector>
 
-#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
-#include <glm/vec4.hpp>
+
+#include <Graphics/GLHandle.h>
+#include <Graphics/MeshData.h>
 
 struct Mesh {
-    struct Vertex {
-        glm::vec3 pos;
-        glm::vec2 uv;
-        glm::vec3 normal;
-        glm::vec4 tangent;
+    using Vertex = MeshData::Vertex;
+    using SkinVertex = MeshData::SkinVertex;
+
+    // What happens to CPU-side geometry after it was uploaded to the GPU.
+    // GL context loss isn't handled, so nothing is kept for re-uploading.
+    enum class Residency {
+        Keep, // keep everything (e.g. for editing)
+        Discard, // free vertices and indices
+        KeepPositionsAndIndices, // keep only what picking/culling needs
     };
 
-    ~Mesh();
-
+    // creates GL objects, can only be called once
     void initGeometry();
+    // frees CPU data according to the residency policy, called by initGeometry
+    void releaseCPUData();
+
+    // bounds, material and name stay after upload
+    MeshData data;
+    // only filled with Residency::KeepPositionsAndIndices
+    std::vector<glm::vec3> positions;
 
-    std::vector<Vertex> vertices;
-    std::vector<std::uint16_t> indices;
+    std::size_t numVertices{0};
+    std::size_t numIndices{0};
+    bool skinned{false};
 
-    std::string materialPath;
-    std::string name;
+    Residency residency{Residency::Keep};
 
-    std::uint32_t vao;
-    std::uint32_t vbo;
-    std::uint32_t ebo;
+    GLVertexArray vao;
+    GLBuffer vbo;
+    GLBuffer ebo;
+    GLBuffer skinVbo;
 
-    std::uint32_t diffuseTexture;
+    GLTexture diffuseTexture;
 };
@@ -0,0 +1,284 @@
+#include "MeshBVH.h"
+
+#include <cassert>
+#include <cmath>
+
+#include <util/Float4.h>
+
+#include <glm/geometric.hpp>
+
+namespace
+{
+// Ericson, "Real-Time Collision Detection", 5.1.5
+glm::vec3 closestPointOnTriangle(
+    const glm::vec3& p,
+    const glm::vec3& a,
+    const glm::vec3& b,
+    const glm::vec3& c)
+{
+    const auto ab = b - a;
+    const auto ac = c - a;
+    const auto ap = p - a;
+    const auto d1 = glm::dot(ab, ap);
+    const auto d2 = glm::dot(ac, ap);
+    if (d1 <= 0.f && d2 <= 0.f) {
+        return a;
+    }
+
+    const auto bp = p - b;
+    const auto d3 = glm::dot(ab, bp);
+    const auto d4 = glm::dot(ac, bp);
+    if (d3 >= 0.f && d4 <= d3) {
+        return b;
+    }
+
+    const auto vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    const auto cp = p - c;
+    const auto d5 = glm::dot(ab, cp);
+    const auto d6 = glm::dot(ac, cp);
+    if (d6 >= 0.f && d5 <= d6) {
+        return c;
+    }
+
+    const auto vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    const auto va = d3 * d6 - d5 * d4;
+    if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f) {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    const auto denom = 1.f / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+} // end of anonymous namespace
+
+void MeshBVH::build(
+    std::span<const glm::vec3> positions,
+    std::span<const std::uint16_t> indices,
+    util::TaskScheduler* scheduler)
+{
+    assert(indices.size() % 3 == 0);
+    const auto numTriangles = indices.size() / 3;
+
+    std::vector<Triangle> source(numTriangles);
+    std::vector<AABB> bounds(numTriangles);
+    for (std::size_t i = 0; i < numTriangles; ++i) {
+        const auto& v0 = positions[indices[i * 3]];
+        const auto& v1 = positions[indices[i * 3 + 1]];
+        const auto& v2 = positions[indices[i * 3 + 2]];
+        source[i] = Triangle{
+            .v0 = v0,
+            .edge1 = v1 - v0,
+            .edge2 = v2 - v0,
+            .index = static_cast<std::uint32_t>(i),
+        };
+        bounds[i] = getBounds(source[i]);
+    }
+
+    bvh.build(bounds, scheduler);
+
+    const auto& order = bvh.getPrimitives();
+    triangles.resize(numTriangles);
+    for (std::size_t i = 0; i < numTriangles; ++i) {
+        triangles[i] = source[order[i]];
+    }
+}
+
+AABB MeshBVH::getBounds(const Triangle& tri)
+{
+    AABB b;
+    b.grow(tri.v0);
+    b.grow(tri.v0 + tri.edge1);
+    b.grow(tri.v0 + tri.edge2);
+    return b;
+}
+
+// Möller-Trumbore
+bool MeshBVH::intersect(const Triangle& tri, const Ray& ray, float maxDistance, RayHit& hit)
+{
+    const auto p = glm::cross(ray.direction, tri.edge2);
+    const auto det = glm::dot(tri.edge1, p);
+    if (std::abs(det) < 1e-12f) {
+        return false; // parallel to the triangle
+    }
+    const auto invDet = 1.f / det;
+
+    const auto s = ray.origin - tri.v0;
+    const auto u = glm::dot(s, p) * invDet;
+    if (u < 0.f || u > 1.f) {
+        return false;
+    }
+
+    const auto q = glm::cross(s, tri.edge1);
+    const auto v = glm::dot(ray.direction, q) * invDet;
+    if (v < 0.f || u + v > 1.f) {
+        return false;
+    }
+
+    const auto t = glm::dot(tri.edge2, q) * invDet;
+    if (t < 0.f || t > maxDistance) {
+        return false;
+    }
+    hit = RayHit{.distance = t, .triangle = tri.index, .instance = 0, .u = u, .v = v};
+    return true;
+}
+
+bool MeshBVH::raycast(const Ray& ray, RayHit& hit) const
+{
+    bool found = false;
+    bvh.traverseRay(ray, [&](std::uint32_t first, std::uint32_t count, float& maxDistance) {
+        for (auto i = first; i < first + count; ++i) {
+            if (intersect(triangles[i], ray, maxDistance, hit)) {
+                maxDistance = hit.distance;
+                found = true;
+            }
+        }
+        return false;
+    });
+    return found;
+}
+
+bool MeshBVH::isOccluded(const Ray& ray) const
+{
+    bool occluded = false;
+    bvh.traverseRay(ray, [&](std::uint32_t first, std::uint32_t count, float& maxDistance) {
+        RayHit hit;
+        for (auto i = first; i < first + count; ++i) {
+            if (intersect(triangles[i], ray, maxDistance, hit)) {
+                occluded = true;
+                return true;
+            }
+        }
+        return false;
+    });
+    return occluded;
+}
+
+std::uint32_t MeshBVH::raycast(const RayPacket& rays, std::uint32_t laneMask, RayHit* hits) const
+{
+    constexpr auto N = RayPacket::SIZE;
+    using util::Float4;
+
+    const auto originX = Float4::load(rays.originX.data());
+    const auto originY = Float4::load(rays.originY.data());
+    const auto originZ = Float4::load(rays.originZ.data());
+    const auto dirX = Float4::load(rays.dirX.data());
+    const auto dirY = Float4::load(rays.dirY.data());
+    const auto dirZ = Float4::load(rays.dirZ.data());
+    const auto zero = Float4::broadcast(0.f);
+    const auto one = Float4::broadcast(1.f);
+
+    std::uint32_t hitMask = 0;
+    bvh.traverseRayPacket(
+        rays,
+        laneMask,
+        [&](std::uint32_t first,
+            std::uint32_t count,
+            std::uint32_t activeMask,
+            std::array<float, N>& maxDistance) {
+            // Möller-Trumbore for all lanes at once
+            for (auto i = first; i < first + count; ++i) {
+                const auto& tri = triangles[i];
+                const auto e1x = Float4::broadcast(tri.edge1.x);
+                const auto e1y = Float4::broadcast(tri.edge1.y);
+                const auto e1z = Float4::broadcast(tri.edge1.z);
+                const auto e2x = Float4::broadcast(tri.edge2.x);
+                const auto e2y = Float4::broadcast(tri.edge2.y);
+                const auto e2z = Float4::broadcast(tri.edge2.z);
+
+                // p = cross(dir, edge2)
+                const auto px = dirY * e2z - e2y * dirZ;
+                const auto py = dirZ * e2x - e2z * dirX;
+                const auto pz = dirX * e2y - e2x * dirY;
+                const auto invDet = one / (e1x * px + e1y * py + e1z * pz);
+
+                const auto sx = originX - Float4::broadcast(tri.v0.x);
+                const auto sy = originY - Float4::broadcast(tri.v0.y);
+                const auto sz = originZ - Float4::broadcast(tri.v0.z);
+                // q = cross(s, edge1)
+                const auto qx = sy * e1z - e1y * sz;
+                const auto qy = sz * e1x - e1z * sx;
+                const auto qz = sx * e1y - e1x * sy;
+
+                const auto u = (sx * px + sy * py + sz * pz) * invDet;
+                const auto v = (dirX * qx + dirY * qy + dirZ * qz) * invDet;
+                const auto t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+                // NaNs and infinities from parallel rays fail the comparisons
+                const auto isHit = (u >= zero) & (v >= zero) & (u + v <= one) & (t >= zero) &
+                                   (t <= Float4::load(maxDistance.data()));
+                const auto mask = isHit.getBits() & activeMask;
+                if (mask == 0) {
+                    continue;
+                }
+
+                std::array<float, N> tLanes, uLanes, vLanes;
+                t.store(tLanes.data());
+                u.store(uLanes.data());
+                v.store(vLanes.data());
+                for (std::size_t lane = 0; lane < N; ++lane) {
+                    if (mask & (1u << lane)) {
+                        maxDistance[lane] = tLanes[lane];
+                        hits[lane] = RayHit{
+                            .distance = tLanes[lane],
+                            .triangle = tri.index,
+                            .instance = 0,
+                            .u = uLanes[lane],
+                            .v = vLanes[lane],
+                        };
+                    }
+                }
+                hitMask |= mask;
+            }
+            return false;
+        });
+    return hitMask;
+}
+
+void MeshBVH::querySphere(
+    const glm::vec3& center,
+    float radius,
+    std::vector<std::uint32_t>& out) const
+{
+    const auto radiusSq = radius * radius;
+    bvh.traverse(
+        [&](const glm::vec3& min, const glm::vec3& max) {
+            const auto d = center - glm::clamp(center, min, max);
+            return glm::dot(d, d) <= radiusSq;
+        },
+        [&](std::uint32_t first, std::uint32_t count) {
+            for (auto i = first; i < first + count; ++i) {
+                const auto& tri = triangles[i];
+                const auto p = closestPointOnTriangle(
+                    center, tri.v0, tri.v0 + tri.edge1, tri.v0 + tri.edge2);
+                const auto d = center - p;
+                if (glm::dot(d, d) <= radiusSq) {
+                    out.push_back(tri.index);
+                }
+            }
+            return false;
+        });
+}
+
+void MeshBVH::queryAABB(const AABB& box, std::vector<std::uint32_t>& out) const
+{
+    bvh.traverse(
+        [&box](const glm::vec3& min, const glm::vec3& max) {
+            return box.overlaps(AABB{.min = min, .max = max});
+        },
+        [&](std::uint32_t first, std::uint32_t count) {
+            for (auto i = first; i < first + count; ++i) {
+                if (box.overlaps(getBounds(triangles[i]))) {
+                    out.push_back(triangles[i].index);
+                }
+            }
+            return false;
+        });
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <Graphics/BVH.h>
+
+#include <glm/vec3.hpp>
+
+// BVH over triangles of a mesh for ray casts (picking, line of sight) and overlap
+// queries (collision). Triangles are copied in the order the BVH's leaves refer to
+// them, so that traversal doesn't jump around the mesh's vertex data.
+class MeshBVH {
+public:
+    void build(
+        std::span<const glm::vec3> positions,
+        std::span<const std::uint16_t> indices,
+        util::TaskScheduler* scheduler = nullptr);
+
+    bool isEmpty() const { return bvh.isEmpty(); }
+    AABB getBounds() const { return bvh.getBounds(); }
+    std::size_t getNumTriangles() const { return triangles.size(); }
+
+    // finds the closest hit (triangles are hit from both sides)
+    bool raycast(const Ray& ray, RayHit& hit) const;
+    // true if anything is hit, faster than raycast (e.g. for line of sight)
+    bool isOccluded(const Ray& ray) const;
+    // closest hits for up to RayPacket::SIZE rays, returns the mask of lanes which hit
+    std::uint32_t raycast(const RayPacket& rays, std::uint32_t laneMask, RayHit* hits) const;
+
+    // appends indices of triangles which touch the sphere
+    void querySphere(const glm::vec3& center, float radius, std::vector<std::uint32_t>& out) const;
+    // appends indices of triangles whose bounds overlap the box (conservative)
+    void queryAABB(const AABB& box, std::vector<std::uint32_t>& out) const;
+
+private:
+    struct Triangle {
+        glm::vec3 v0;
+        glm::vec3 edge1; // v1 - v0
+        glm::vec3 edge2; // v2 - v0
+        std::uint32_t index; // in the source mesh
+    };
+
+    static bool intersect(const Triangle& tri, const Ray& ray, float maxDistance, RayHit& hit);
+    static AABB getBounds(const Triangle& tri);
+
+    BVH bvh;
+    std::vector<Triangle> triangles; // same order as bvh.getPrimitives()
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// CPU-side geometry of a mesh, as loaded from glTF or a cooked model. GL objects are
+// created from it by Mesh, so the loaders and the asset packer don't depend on GL.
+struct MeshData {
+    struct Vertex {
+        glm::vec3 pos;
+        glm::vec2 uv;
+        glm::vec3 normal;
+        glm::vec4 tangent;
+    };
+
+    // stored in a separate buffer, only present in skinned meshes
+    struct SkinVertex {
+        std::array<std::uint8_t, 4> joints;
+        glm::vec4 weights;
+    };
+
+    std::vector<Vertex> vertices;
+    std::vector<std::uint16_t> indices;
+    std::vector<SkinVertex> skinVertices;
+
+    // local space bounds, computed on load
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+
+    std::string materialPath;
+    std::string name;
+};
@@ -1,14 +1,24 @@
 #pragma once
 
+#include "Animation.h"
 #include "Mesh.h"
+#include "Skeleton.h"
 
 #include <glm/gtc/quaternion.hpp>
 #include <glm/vec3.hpp>
 
+// Runtime model, created from ModelData by util::loadModel. Its meshes get GL objects
+// when Mesh::initGeometry is called.
 struct Model {
     glm::vec3 position;
     glm::quat rotation;
     glm::vec3 scale;
 
     std::vector<Mesh> meshes;
+
+    // only present in skinned models
+    Skeleton skeleton;
+    std::vector<AnimationClip> animations;
+
+    bool hasSkeleton() const { return skeleton.getNumJoints() != 0; }
 };
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Animation.h"
+#include "MeshData.h"
+#include "Skeleton.h"
+
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+// Model as loaded from a file, before anything is uploaded to the GPU (see Model)
+struct ModelData {
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 scale;
+
+    std::vector<MeshData> meshes;
+
+    // only present in skinned models
+    Skeleton skeleton;
+    std::vector<AnimationClip> animations;
+};
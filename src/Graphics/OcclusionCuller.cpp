@@ -0,0 +1,294 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include <util/Float4.h>
+#include <util/TaskScheduler.h>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace
+{
+template<typename F>
+void parallelFor(util::TaskScheduler* scheduler, std::size_t count, std::size_t grainSize, F&& f)
+{
+    if (scheduler) {
+        scheduler->parallelFor(count, grainSize, f);
+    } else {
+        f(0, count);
+    }
+}
+
+// returns false if the point is behind the near plane
+bool toScreen(const glm::vec4& clip, float width, float height, glm::vec3& screen)
+{
+    if (clip.w <= 0.f || clip.z < -clip.w) {
+        return false;
+    }
+    const auto ndc = glm::vec3{clip} / clip.w;
+    screen = glm::vec3{
+        (ndc.x * 0.5f + 0.5f) * width,
+        (ndc.y * 0.5f + 0.5f) * height,
+        ndc.z * 0.5f + 0.5f,
+    };
+    return true;
+}
+
+} // end of anonymous namespace
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+{
+    assert(width % 4 == 0 && "rows are rasterized 4 pixels at a time");
+    std::size_t offset = 0;
+    while (true) {
+        levels.push_back(Level{.width = width, .height = height, .offset = offset});
+        offset += static_cast<std::size_t>(width) * height;
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    depth.resize(offset, 1.f);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& vp)
+{
+    this->vp = vp;
+    occluders.clear();
+    triangles.clear();
+    numOccluderTriangles = 0;
+}
+
+void OcclusionCuller::addOccluder(
+    std::span<const glm::vec3> positions,
+    std::span<const std::uint16_t> indices,
+    const glm::mat4& model)
+{
+    assert(indices.size() % 3 == 0);
+    const auto firstTriangle = occluders.empty() ?
+                                   0 :
+                                   occluders.back().firstTriangle +
+                                       occluders.back().indices.size() / 3;
+    occluders.push_back(Occluder{
+        .positions = positions,
+        .indices = indices,
+        .mvp = vp * model,
+        .firstTriangle = firstTriangle,
+    });
+}
+
+void OcclusionCuller::rasterize(util::TaskScheduler* scheduler)
+{
+    const auto& base = levels[0];
+    std::fill_n(depth.begin(), static_cast<std::size_t>(base.width) * base.height, 1.f);
+
+    const auto numTriangles = occluders.empty() ? 0 :
+                                                  occluders.back().firstTriangle +
+                                                      occluders.back().indices.size() / 3;
+    triangles.resize(numTriangles);
+
+    // transform to screen space
+    static constexpr std::size_t setupGrainSize = 1024;
+    const auto setup = [this](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            // occluders are sorted by firstTriangle
+            const auto it = std::upper_bound(
+                occluders.begin(),
+                occluders.end(),
+                i,
+                [](std::size_t triangle, const Occluder& o) { return triangle < o.firstTriangle; });
+            const auto& occluder = *(it - 1);
+            setupTriangle(occluder, i - occluder.firstTriangle);
+        }
+    };
+    parallelFor(scheduler, numTriangles, setupGrainSize, setup);
+    numOccluderTriangles = std::count_if(triangles.begin(), triangles.end(), [](const auto& t) {
+        return t.minY <= t.maxY;
+    });
+
+    // bands don't share pixels, so they don't need to synchronize
+    const auto numBands = (base.height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    parallelFor(scheduler, numBands, 1, [this, &base](std::size_t begin, std::size_t end) {
+        for (auto band = begin; band < end; ++band) {
+            const auto minY = static_cast<int>(band) * BAND_HEIGHT;
+            rasterizeBand(minY, std::min(minY + BAND_HEIGHT, base.height) - 1);
+        }
+    });
+
+    buildHierarchy();
+}
+
+void OcclusionCuller::setupTriangle(const Occluder& occluder, std::size_t triangle)
+{
+    auto& tri = triangles[occluder.firstTriangle + triangle];
+    tri.minY = 1;
+    tri.maxY = 0; // rejected until proven otherwise
+
+    const auto width = static_cast<float>(levels[0].width);
+    const auto height = static_cast<float>(levels[0].height);
+    glm::vec3 v[3];
+    for (int i = 0; i < 3; ++i) {
+        const auto& p = occluder.positions[occluder.indices[triangle * 3 + i]];
+        if (!toScreen(occluder.mvp * glm::vec4{p, 1.f}, width, height, v[i])) {
+            return;
+        }
+    }
+
+    // back-facing (front faces are counter-clockwise) or degenerate
+    const auto area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+    if (area <= 0.f) {
+        return;
+    }
+
+    // rows whose pixel centers can be inside
+    const auto minY = std::min({v[0].y, v[1].y, v[2].y});
+    const auto maxY = std::max({v[0].y, v[1].y, v[2].y});
+    tri.minY = std::max(0, static_cast<int>(std::ceil(minY - 0.5f)));
+    tri.maxY = std::min(levels[0].height - 1, static_cast<int>(std::floor(maxY - 0.5f)));
+    tri.v0 = v[0];
+    tri.v1 = v[1];
+    tri.v2 = v[2];
+}
+
+void OcclusionCuller::rasterizeBand(int bandMinY, int bandMaxY)
+{
+    const auto width = levels[0].width;
+    for (const auto& tri : triangles) {
+        if (tri.minY > tri.maxY || tri.maxY < bandMinY || tri.minY > bandMaxY) {
+            continue;
+        }
+        const auto minY = std::max(tri.minY, bandMinY);
+        const auto maxY = std::min(tri.maxY, bandMaxY);
+        const auto minX = std::max(
+            0, static_cast<int>(std::ceil(std::min({tri.v0.x, tri.v1.x, tri.v2.x}) - 0.5f)));
+        const auto maxX = std::min(
+            width - 1,
+            static_cast<int>(std::floor(std::max({tri.v0.x, tri.v1.x, tri.v2.x}) - 0.5f)));
+        if (minX > maxX) {
+            continue;
+        }
+
+        // edge functions e(x, y) = a * x + b * y + c, non-negative inside
+        const auto edge = [](const glm::vec3& from, const glm::vec3& to) {
+            const auto a = from.y - to.y;
+            const auto b = to.x - from.x;
+            return glm::vec3{a, b, -(a * from.x + b * from.y)};
+        };
+        const auto e0 = edge(tri.v1, tri.v2);
+        const auto e1 = edge(tri.v2, tri.v0);
+        const auto e2 = edge(tri.v0, tri.v1);
+
+        // depth is linear in screen space: z = dzdx * x + dzdy * y + z0
+        const auto n = glm::cross(tri.v1 - tri.v0, tri.v2 - tri.v0);
+        const auto dzdx = -n.x / n.z;
+        const auto dzdy = -n.y / n.z;
+        const auto z0 = tri.v0.z - dzdx * tri.v0.x - dzdy * tri.v0.y;
+
+        // 4 pixels at a time, starting at a multiple of 4 so that rows (and bands,
+        // which are rasterized in parallel) are never crossed. Pixels outside of
+        // the bounding box are outside of the triangle, so they fail the edge tests.
+        const auto e0x = util::Float4::broadcast(e0.x);
+        const auto e1x = util::Float4::broadcast(e1.x);
+        const auto e2x = util::Float4::broadcast(e2.x);
+        const auto dzdx4 = util::Float4::broadcast(dzdx);
+        const auto zero = util::Float4::broadcast(0.f);
+        const auto firstX = minX & ~3;
+        for (int y = minY; y <= maxY; ++y) {
+            const auto py = y + 0.5f;
+            const auto rowE0 = util::Float4::broadcast(e0.y * py + e0.z);
+            const auto rowE1 = util::Float4::broadcast(e1.y * py + e1.z);
+            const auto rowE2 = util::Float4::broadcast(e2.y * py + e2.z);
+            const auto rowZ = util::Float4::broadcast(dzdy * py + z0);
+            float* row = &depth[static_cast<std::size_t>(y) * width];
+            for (int x = firstX; x <= maxX; x += 4) {
+                const auto px = util::Float4::sequence(x + 0.5f);
+                const auto inside = (e0x * px + rowE0 >= zero) & (e1x * px + rowE1 >= zero) &
+                                    (e2x * px + rowE2 >= zero);
+                const auto old = util::Float4::load(row + x);
+                util::select(inside, util::min(old, dzdx4 * px + rowZ), old).store(row + x);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::buildHierarchy()
+{
+    for (std::size_t l = 1; l < levels.size(); ++l) {
+        const auto& src = levels[l - 1];
+        const auto& dst = levels[l];
+        for (int y = 0; y < dst.height; ++y) {
+            const auto y0 = y * 2;
+            const auto y1 = std::min(y0 + 1, src.height - 1);
+            for (int x = 0; x < dst.width; ++x) {
+                const auto x0 = x * 2;
+                const auto x1 = std::min(x0 + 1, src.width - 1);
+                const auto* s = &depth[src.offset];
+                depth[dst.offset + static_cast<std::size_t>(y) * dst.width + x] = std::max(
+                    std::max(s[y0 * src.width + x0], s[y0 * src.width + x1]),
+                    std::max(s[y1 * src.width + x0], s[y1 * src.width + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(
+    const glm::vec3& boundsMin,
+    const glm::vec3& boundsMax,
+    const glm::mat4& model) const
+{
+    const auto mvp = vp * model;
+    const auto width = static_cast<float>(levels[0].width);
+    const auto height = static_cast<float>(levels[0].height);
+
+    // screen rect and the nearest depth of the box
+    glm::vec3 rectMin{std::numeric_limits<float>::max()};
+    glm::vec3 rectMax{-std::numeric_limits<float>::max()};
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec4 corner{
+            i & 1 ? boundsMax.x : boundsMin.x,
+            i & 2 ? boundsMax.y : boundsMin.y,
+            i & 4 ? boundsMax.z : boundsMin.z,
+            1.f,
+        };
+        glm::vec3 screen;
+        if (!toScreen(mvp * corner, width, height, screen)) {
+            return true; // crosses the near plane
+        }
+        rectMin = glm::min(rectMin, screen);
+        rectMax = glm::max(rectMax, screen);
+    }
+
+    const auto x0 = std::max(0, static_cast<int>(std::floor(rectMin.x)));
+    const auto y0 = std::max(0, static_cast<int>(std::floor(rectMin.y)));
+    const auto x1 = std::min(levels[0].width - 1, static_cast<int>(std::floor(rectMax.x)));
+    const auto y1 = std::min(levels[0].height - 1, static_cast<int>(std::floor(rectMax.y)));
+    if (x0 > x1 || y0 > y1) {
+        return true; // off-screen, it's up to frustum culling
+    }
+
+    // the coarsest level where the rect covers at most 4x4 texels
+    std::size_t l = 0;
+    while (l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) >= 4 || (y1 >> l) - (y0 >> l) >= 4)) {
+        ++l;
+    }
+    for (int y = y0 >> l; y <= (y1 >> l); ++y) {
+        for (int x = x0 >> l; x <= (x1 >> l); ++x) {
+            if (getDepth(static_cast<int>(l), x, y) >= rectMin.z) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+float OcclusionCuller::getDepth(int level, int x, int y) const
+{
+    const auto& l = levels[level];
+    assert(x >= 0 && x < l.width && y >= 0 && y < l.height);
+    return depth[l.offset + static_cast<std::size_t>(y) * l.width + x];
+}
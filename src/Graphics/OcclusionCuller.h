@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace util
+{
+class TaskScheduler;
+}
+
+// Software occlusion culling: a few big meshes close to the camera are rasterized
+// into a low-res depth buffer on the CPU, then bounding boxes of everything else are
+// tested against its hierarchical (max) depth, so hidden meshes are never submitted.
+// The screen is split into bands which are rasterized in parallel, 4 pixels of a row
+// are rasterized at once with SIMD (see util/Float4.h).
+// Occluders are only drawn where pixel centers are covered, so culling is slightly
+// optimistic at their edges.
+class OcclusionCuller {
+public:
+    // width has to be a multiple of 4
+    explicit OcclusionCuller(int width = 256, int height = 192);
+
+    void beginFrame(const glm::mat4& vp);
+    // Positions and indices have to stay alive until rasterize() is called.
+    // Triangles crossing the near plane are skipped (occluding less is always safe).
+    void addOccluder(
+        std::span<const glm::vec3> positions,
+        std::span<const std::uint16_t> indices,
+        const glm::mat4& model);
+    // rasterizes occluders which were added since beginFrame and builds the hierarchy
+    void rasterize(util::TaskScheduler* scheduler = nullptr);
+
+    // returns false if the box is completely behind occluders, can be called from any thread
+    bool isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model)
+        const;
+
+    // front-facing triangles in front of the near plane which were rasterized
+    std::size_t getNumOccluderTriangles() const { return numOccluderTriangles; }
+
+    int getWidth(int level = 0) const { return levels[level].width; }
+    int getHeight(int level = 0) const { return levels[level].height; }
+    std::size_t getNumLevels() const { return levels.size(); }
+    // depth in [0, 1], rows go from the bottom of the screen to the top
+    float getDepth(int level, int x, int y) const;
+
+private:
+    struct Level {
+        int width;
+        int height;
+        std::size_t offset; // in depth
+    };
+
+    struct Occluder {
+        std::span<const glm::vec3> positions;
+        std::span<const std::uint16_t> indices;
+        glm::mat4 mvp;
+        std::size_t firstTriangle;
+    };
+
+    // occluder triangle in screen space (pixels, depth in [0, 1])
+    struct ScreenTriangle {
+        glm::vec3 v0, v1, v2; // counter-clockwise
+        int minY, maxY; // rows it covers, minY > maxY for rejected triangles
+    };
+
+    void setupTriangle(const Occluder& occluder, std::size_t triangle);
+    void rasterizeBand(int bandMinY, int bandMaxY);
+    void buildHierarchy();
+
+    static constexpr int BAND_HEIGHT = 16;
+
+    std::vector<Level> levels;
+    // all levels, level 0 has the nearest occluder depth per pixel,
+    // the others - the farthest depth of 2x2 texels of the previous level
+    std::vector<float> depth;
+
+    glm::mat4 vp;
+    std::vector<Occluder> occluders;
+    std::vector<ScreenTriangle> triangles;
+    std::size_t numOccluderTriangles{0};
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#include <Graphics/GLHandle.h>
+
+// How the offscreen scene is scaled to the window (the aspect ratio is always kept)
+enum class ScaleMode {
+    Fit, // as large as possible
+    Integer, // largest integer multiple of the render size which fits, pixels stay square
+};
+
+enum class UpscaleFilter {
+    Nearest,
+    // bilinear only between texels, so non-integer scales don't shimmer or look blurry
+    SharpBilinear,
+};
+
+// Offscreen color + depth/stencil buffer the scene is drawn into before it's upscaled to the window
+class RenderTarget {
+public:
+    void create(int width, int height);
+    void bind() const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    std::uint32_t getColorTexture() const { return colorTexture.get(); }
+
+private:
+    int width{0};
+    int height{0};
+
+    GLFramebuffer framebuffer;
+    GLTexture colorTexture;
+    GLRenderbuffer depthBuffer;
+};
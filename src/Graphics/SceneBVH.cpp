@@ -0,0 +1,140 @@
+#include "SceneBVH.h"
+
+#include <Graphics/MeshBVH.h>
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+void SceneBVH::build(std::span<const Instance> newInstances, util::TaskScheduler* scheduler)
+{
+    instances.clear();
+    std::vector<AABB> bounds;
+    bounds.reserve(newInstances.size());
+    for (const auto& instance : newInstances) {
+        instances.push_back(InstanceData{
+            .mesh = instance.mesh,
+            .transform = instance.transform,
+            .inverseTransform = glm::inverse(instance.transform),
+            .invScale = 1.f / glm::length(glm::vec3{instance.transform[0]}),
+        });
+
+        // world bounds of the local box's corners
+        const auto local = instance.mesh->getBounds();
+        AABB world;
+        for (int i = 0; i < 8; ++i) {
+            const glm::vec3 corner{
+                i & 1 ? local.max.x : local.min.x,
+                i & 2 ? local.max.y : local.min.y,
+                i & 4 ? local.max.z : local.min.z,
+            };
+            world.grow(glm::vec3{instance.transform * glm::vec4{corner, 1.f}});
+        }
+        bounds.push_back(world);
+    }
+    bvh.build(bounds, scheduler);
+}
+
+Ray SceneBVH::toLocal(const InstanceData& instance, const Ray& ray, float maxDistance)
+{
+    return Ray{
+        .origin = glm::vec3{instance.inverseTransform * glm::vec4{ray.origin, 1.f}},
+        .direction = glm::vec3{instance.inverseTransform * glm::vec4{ray.direction, 0.f}},
+        .maxDistance = maxDistance,
+    };
+}
+
+bool SceneBVH::raycast(const Ray& ray, RayHit& hit) const
+{
+    bool found = false;
+    const auto& primitives = bvh.getPrimitives();
+    bvh.traverseRay(ray, [&](std::uint32_t first, std::uint32_t count, float& maxDistance) {
+        for (auto i = first; i < first + count; ++i) {
+            const auto& instance = instances[primitives[i]];
+            RayHit instanceHit;
+            if (instance.mesh->raycast(toLocal(instance, ray, maxDistance), instanceHit)) {
+                hit = instanceHit;
+                hit.instance = primitives[i];
+                maxDistance = hit.distance;
+                found = true;
+            }
+        }
+        return false;
+    });
+    return found;
+}
+
+bool SceneBVH::isOccluded(const Ray& ray) const
+{
+    bool occluded = false;
+    const auto& primitives = bvh.getPrimitives();
+    bvh.traverseRay(ray, [&](std::uint32_t first, std::uint32_t count, float& maxDistance) {
+        for (auto i = first; i < first + count; ++i) {
+            const auto& instance = instances[primitives[i]];
+            if (instance.mesh->isOccluded(toLocal(instance, ray, maxDistance))) {
+                occluded = true;
+                return true;
+            }
+        }
+        return false;
+    });
+    return occluded;
+}
+
+void SceneBVH::querySphere(
+    const glm::vec3& center,
+    float radius,
+    std::vector<TriangleRef>& out) const
+{
+    const auto radiusSq = radius * radius;
+    const auto& primitives = bvh.getPrimitives();
+    std::vector<std::uint32_t> triangles;
+    bvh.traverse(
+        [&](const glm::vec3& min, const glm::vec3& max) {
+            const auto d = center - glm::clamp(center, min, max);
+            return glm::dot(d, d) <= radiusSq;
+        },
+        [&](std::uint32_t first, std::uint32_t count) {
+            for (auto i = first; i < first + count; ++i) {
+                const auto& instance = instances[primitives[i]];
+                const auto localCenter =
+                    glm::vec3{instance.inverseTransform * glm::vec4{center, 1.f}};
+                triangles.clear();
+                instance.mesh->querySphere(localCenter, radius * instance.invScale, triangles);
+                for (const auto triangle : triangles) {
+                    out.push_back(TriangleRef{.instance = primitives[i], .triangle = triangle});
+                }
+            }
+            return false;
+        });
+}
+
+void SceneBVH::queryAABB(const AABB& box, std::vector<TriangleRef>& out) const
+{
+    const auto& primitives = bvh.getPrimitives();
+    std::vector<std::uint32_t> triangles;
+    bvh.traverse(
+        [&box](const glm::vec3& min, const glm::vec3& max) {
+            return box.overlaps(AABB{.min = min, .max = max});
+        },
+        [&](std::uint32_t first, std::uint32_t count) {
+            for (auto i = first; i < first + count; ++i) {
+                const auto& instance = instances[primitives[i]];
+                // local bounds of the box's corners
+                AABB localBox;
+                for (int c = 0; c < 8; ++c) {
+                    const glm::vec3 corner{
+                        c & 1 ? box.max.x : box.min.x,
+                        c & 2 ? box.max.y : box.min.y,
+                        c & 4 ? box.max.z : box.min.z,
+                    };
+                    localBox.grow(glm::vec3{instance.inverseTransform * glm::vec4{corner, 1.f}});
+                }
+                triangles.clear();
+                instance.mesh->queryAABB(localBox, triangles);
+                for (const auto triangle : triangles) {
+                    out.push_back(TriangleRef{.instance = primitives[i], .triangle = triangle});
+                }
+            }
+            return false;
+        });
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <Graphics/BVH.h>
+
+#include <glm/mat4x4.hpp>
+
+class MeshBVH;
+
+// Top-level BVH over mesh instances. Rebuilding it is cheap (one box per instance),
+// so it's meant to be rebuilt whenever instances move.
+// Instance transforms can only rotate, translate and scale uniformly.
+class SceneBVH {
+public:
+    struct Instance {
+        const MeshBVH* mesh;
+        glm::mat4 transform;
+    };
+
+    struct TriangleRef {
+        std::uint32_t instance;
+        std::uint32_t triangle;
+    };
+
+    void build(std::span<const Instance> instances, util::TaskScheduler* scheduler = nullptr);
+
+    // hit.instance is the index of the instance in the span passed to build()
+    bool raycast(const Ray& ray, RayHit& hit) const;
+    bool isOccluded(const Ray& ray) const;
+
+    void querySphere(const glm::vec3& center, float radius, std::vector<TriangleRef>& out) const;
+    // conservative, like MeshBVH::queryAABB
+    void queryAABB(const AABB& box, std::vector<TriangleRef>& out) const;
+
+private:
+    struct InstanceData {
+        const MeshBVH* mesh;
+        glm::mat4 transform;
+        glm::mat4 inverseTransform;
+        float invScale;
+    };
+
+    // returns the ray in instance's local space (distances along it stay the same)
+    static Ray toLocal(const InstanceData& instance, const Ray& ray, float maxDistance);
+
+    BVH bvh;
+    std::vector<InstanceData> instances;
+};
@@ -0,0 +1,239 @@
+#include "Shader.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SDL.h>
+
+#include <Graphics/ShaderUniforms.h>
+#include <Platform/gl.h>
+#include <util/GLUtil.h>
+#include <util/Log.h>
+
+namespace
+{
+GLuint compileShader(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    if (!util::printShaderCompilationErrors(shader, source)) {
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// GLSL ES 3.00 has no layout(binding), so blocks are assigned their binding points here
+void bindUniformBlocks(const GLProgram& program)
+{
+    static const std::pair<const char*, UniformBlock> blocks[] = {
+        {"Frame", UniformBlock::Frame},
+        {"Object", UniformBlock::Object},
+        {"Skin", UniformBlock::Skin},
+    };
+    for (const auto& [name, block] : blocks) {
+        const auto index = glGetUniformBlockIndex(program.get(), name);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program.get(), index, static_cast<GLuint>(block));
+        }
+    }
+}
+
+#ifndef __EMSCRIPTEN__
+// ARB_get_program_binary (core in GL 4.1) is not in our glad build - load it manually
+constexpr GLenum GL_PROGRAM_BINARY_RETRIEVABLE_HINT_ = 0x8257;
+constexpr GLenum GL_PROGRAM_BINARY_LENGTH_ = 0x8741;
+constexpr GLenum GL_NUM_PROGRAM_BINARY_FORMATS_ = 0x87FE;
+
+struct ProgramBinaryFuncs {
+    using GetProgramBinary = void(GLAD_API_PTR*)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    using ProgramBinary = void(GLAD_API_PTR*)(GLuint, GLenum, const void*, GLsizei);
+    using ProgramParameteri = void(GLAD_API_PTR*)(GLuint, GLenum, GLint);
+
+    GetProgramBinary getProgramBinary{nullptr};
+    ProgramBinary programBinary{nullptr};
+    ProgramParameteri programParameteri{nullptr};
+
+    bool isSupported() const { return getProgramBinary && programBinary && programParameteri; }
+};
+
+const ProgramBinaryFuncs& getProgramBinaryFuncs()
+{
+    static const auto funcs = []() {
+        ProgramBinaryFuncs f;
+        if (!SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) {
+            return f;
+        }
+        GLint numFormats{0};
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_, &numFormats);
+        if (numFormats == 0) {
+            return f;
+        }
+        f.getProgramBinary =
+            (ProgramBinaryFuncs::GetProgramBinary)SDL_GL_GetProcAddress("glGetProgramBinary");
+        f.programBinary =
+            (ProgramBinaryFuncs::ProgramBinary)SDL_GL_GetProcAddress("glProgramBinary");
+        f.programParameteri =
+            (ProgramBinaryFuncs::ProgramParameteri)SDL_GL_GetProcAddress("glProgramParameteri");
+        return f;
+    }();
+    return funcs;
+}
+
+// binaries are only valid for the same driver
+std::string getDriverHash()
+{
+    std::string driver;
+    for (const auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        if (const auto* str = glGetString(name)) {
+            driver += reinterpret_cast<const char*>(str);
+        }
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%016zx", std::hash<std::string>{}(driver));
+    return buf;
+}
+
+constexpr std::uint32_t PROGRAM_BINARY_MAGIC = 0x4e424853; // "SHBN"
+
+struct ProgramBinaryHeader {
+    std::uint32_t magic;
+    std::uint32_t format;
+};
+
+GLProgram loadProgramBinary(const ProgramBinaryFuncs& funcs, const std::filesystem::path& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f.good()) {
+        return {};
+    }
+
+    ProgramBinaryHeader header{};
+    f.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!f.good() || header.magic != PROGRAM_BINARY_MAGIC) {
+        return {};
+    }
+    std::vector<char> binary{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+
+    auto program = GLProgram::create();
+    funcs.programBinary(
+        program.get(), header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    // can fail after driver updates - just recompile in that case
+    GLint status;
+    glGetProgramiv(program.get(), GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        return {};
+    }
+    bindUniformBlocks(program);
+    return program;
+}
+
+void saveProgramBinary(
+    const ProgramBinaryFuncs& funcs,
+    const GLProgram& program,
+    const std::filesystem::path& path)
+{
+    GLint length{0};
+    glGetProgramiv(program.get(), GL_PROGRAM_BINARY_LENGTH_, &length);
+    if (length == 0) {
+        return;
+    }
+
+    ProgramBinaryHeader header{.magic = PROGRAM_BINARY_MAGIC, .format = 0};
+    std::vector<char> binary(length);
+    funcs.getProgramBinary(program.get(), length, nullptr, &header.format, binary.data());
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    std::ofstream f(path, std::ios::binary);
+    if (!f.good()) {
+        LOG_WARN("Failed to write program binary to '%s'", path.string().c_str());
+        return;
+    }
+    f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    f.write(binary.data(), binary.size());
+}
+#endif
+
+GLProgram linkProgram(GLuint vertexShader, GLuint fragmentShader, bool retrievable)
+{
+    auto program = GLProgram::create();
+#ifndef __EMSCRIPTEN__
+    if (retrievable) {
+        getProgramBinaryFuncs().programParameteri(
+            program.get(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT_, GL_TRUE);
+    }
+#endif
+    glAttachShader(program.get(), vertexShader);
+    glAttachShader(program.get(), fragmentShader);
+    glLinkProgram(program.get());
+
+    // check linking status
+    const bool ok = util::printShaderLinkErrors(program.get());
+
+    // detach and clean-up
+    glDetachShader(program.get(), vertexShader);
+    glDetachShader(program.get(), fragmentShader);
+
+    if (!ok) {
+        return {};
+    }
+    bindUniformBlocks(program);
+    return program;
+}
+
+GLProgram compileProgram(const char* vertexSource, const char* fragmentSource, bool retrievable)
+{
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+    GLProgram program;
+    if (vertexShader != 0 && fragmentShader != 0) {
+        program = linkProgram(vertexShader, fragmentShader, retrievable);
+    }
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+}
+
+namespace util
+{
+GLProgram compileShaderProgram(const char* vertexSource, const char* fragmentSource)
+{
+    return compileProgram(vertexSource, fragmentSource, false);
+}
+
+GLProgram loadShaderProgram(const EmbeddedShader& shader, const std::filesystem::path& cacheDir)
+{
+#ifdef __EMSCRIPTEN__
+    return compileProgram(shader.vertexSource, shader.fragmentSource, false);
+#else
+    const auto& funcs = getProgramBinaryFuncs();
+    if (!funcs.isSupported()) {
+        return compileProgram(shader.vertexSource, shader.fragmentSource, false);
+    }
+
+    const auto binaryPath = cacheDir / (std::string(shader.name) + "-" + shader.sourceHash +
+                                        "-" + getDriverHash() + ".bin");
+    if (auto program = loadProgramBinary(funcs, binaryPath); program) {
+        return program;
+    }
+
+    auto program = compileProgram(shader.vertexSource, shader.fragmentSource, true);
+    if (program) {
+        saveProgramBinary(funcs, program, binaryPath);
+    }
+    return program;
+#endif
+}
+}
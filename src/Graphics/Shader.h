@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+
+#include <Graphics/GLHandle.h>
+
+// Shader variant with sources resolved at build time (see cmake/EmbedShaders.cmake)
+struct EmbeddedShader {
+    const char* name;
+
+    // single-source GLSL files (in assets/shaders) the variant was built from
+    const char* vertexFile;
+    const char* fragmentFile;
+
+    // #version, precision and variant #defines
+    const char* vertexPrefix;
+    const char* fragmentPrefix;
+
+    // prefix + file contents
+    const char* vertexSource;
+    const char* fragmentSource;
+
+    const char* sourceHash;
+};
+
+namespace util
+{
+// Returns an empty handle (and prints errors) if compilation or linking failed
+GLProgram compileShaderProgram(const char* vertexSource, const char* fragmentSource);
+
+// Loads the program from the binary cache if possible, otherwise compiles
+// it and stores its binary in the cache. Program binaries are only used
+// on desktop GL - on the web the embedded source is always compiled.
+GLProgram loadShaderProgram(const EmbeddedShader& shader, const std::filesystem::path& cacheDir);
+}
@@ -0,0 +1,105 @@
+#include "ShaderHotReloader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <Graphics/Shader.h>
+#include <util/Log.h>
+
+namespace
+{
+bool readFileIntoString(const std::filesystem::path& path, std::string& str)
+{
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    if (!f.good()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << f.rdbuf();
+    str = buffer.str();
+    return true;
+}
+}
+
+ShaderHotReloader::ShaderHotReloader(std::filesystem::path shaderDir) :
+    shaderDir(shaderDir), watcher(std::move(shaderDir))
+{}
+
+void ShaderHotReloader::add(const EmbeddedShader& shader, GLProgram& program)
+{
+    entries.push_back(Entry{.shader = &shader, .program = &program});
+    watcher.addFile(shader.vertexFile);
+    watcher.addFile(shader.fragmentFile);
+}
+
+void ShaderHotReloader::update()
+{
+    // forget about finished jobs
+    std::erase_if(loadJobs, [](const std::future<void>& job) {
+        return job.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+
+    const auto changedFiles = watcher.pollChanges();
+    if (changedFiles.empty()) {
+        return;
+    }
+
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const auto& shader = *entries[i].shader;
+        const auto usesFile = [&shader](const std::filesystem::path& path) {
+            return path.filename() == shader.vertexFile || path.filename() == shader.fragmentFile;
+        };
+        if (std::any_of(changedFiles.begin(), changedFiles.end(), usesFile)) {
+            loadJobs.push_back(std::async(std::launch::async, [this, i]() { loadSources(i); }));
+        }
+    }
+}
+
+void ShaderHotReloader::loadSources(std::size_t entryIndex)
+{
+    const auto& shader = *entries[entryIndex].shader;
+
+    std::string vertexFileSource, fragmentFileSource;
+    if (!readFileIntoString(shaderDir / shader.vertexFile, vertexFileSource) ||
+        !readFileIntoString(shaderDir / shader.fragmentFile, fragmentFileSource)) {
+        LOG_ERROR("Failed to read sources of shader '%s'", shader.name);
+        return;
+    }
+    PendingReload reload{
+        .entryIndex = entryIndex,
+        .vertexSource = shader.vertexPrefix + vertexFileSource,
+        .fragmentSource = shader.fragmentPrefix + fragmentFileSource,
+    };
+
+    std::lock_guard lock(pendingMutex);
+    // newer sources replace the ones which were not compiled yet
+    std::erase_if(pendingReloads, [entryIndex](const PendingReload& r) {
+        return r.entryIndex == entryIndex;
+    });
+    pendingReloads.push_back(std::move(reload));
+}
+
+void ShaderHotReloader::applyPendingReloads()
+{
+    std::vector<PendingReload> reloads;
+    {
+        std::lock_guard lock(pendingMutex);
+        std::swap(reloads, pendingReloads);
+    }
+
+    for (const auto& reload : reloads) {
+        const auto& entry = entries[reload.entryIndex];
+        auto program =
+            util::compileShaderProgram(reload.vertexSource.c_str(), reload.fragmentSource.c_str());
+        if (!program) {
+            LOG_ERROR(
+                "Failed to reload shader '%s', keeping the last good program",
+                entry.shader->name);
+            continue;
+        }
+        // the old program is deleted at the end of the frame
+        *entry.program = std::move(program);
+        LOG_INFO("Reloaded shader '%s'", entry.shader->name);
+    }
+}
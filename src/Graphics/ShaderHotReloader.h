@@ -0,0 +1,53 @@
+#pragma once
+
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Graphics/GLHandle.h>
+#include <util/FileWatcher.h>
+
+struct EmbeddedShader;
+
+// Rebuilds shader programs when their GLSL sources change on disk.
+// Sources are read in the background, while compilation happens in
+// applyPendingReloads on the thread which owns the GL context, so programs
+// are only swapped at the start of a frame. If the new source fails to
+// compile, the last good program is kept.
+class ShaderHotReloader {
+public:
+    explicit ShaderHotReloader(std::filesystem::path shaderDir);
+
+    // `program` is replaced on reload, so it must outlive the reloader
+    void add(const EmbeddedShader& shader, GLProgram& program);
+
+    // checks for changed files, call once per frame
+    void update();
+    // GL thread only
+    void applyPendingReloads();
+
+private:
+    struct Entry {
+        const EmbeddedShader* shader;
+        GLProgram* program;
+    };
+
+    struct PendingReload {
+        std::size_t entryIndex;
+        std::string vertexSource;
+        std::string fragmentSource;
+    };
+
+    void loadSources(std::size_t entryIndex);
+
+    std::filesystem::path shaderDir;
+    util::FileWatcher watcher;
+    std::vector<Entry> entries;
+
+    std::vector<std::future<void>> loadJobs;
+
+    std::mutex pendingMutex;
+    std::vector<PendingReload> pendingReloads;
+};
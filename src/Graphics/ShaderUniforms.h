@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// std140 uniform blocks shared by the shaders in assets/shaders (keep in sync).
+// Programs get their blocks bound to these binding points when they're created.
+// Constants at the end of the file are also #defined in shaders (see cmake/EmbedShaders.cmake).
+enum class UniformBlock : std::uint32_t {
+    Frame, // FrameUniforms
+    Object, // ObjectUniforms
+    Skin, // MAX_JOINTS matrices
+};
+
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 vp;
+    glm::vec4 time; // x - seconds since start
+};
+
+struct ObjectUniforms {
+    glm::mat4 model;
+};
+
+// max number of joints a skinned mesh can have
+inline constexpr std::size_t MAX_JOINTS = 64;
@@ -0,0 +1,189 @@
+#include "Skeleton.h"
+
+#include <cassert>
+#include <cmath>
+
+void SkeletonPose::resize(std::size_t numJoints)
+{
+    for (auto* v : {&tx, &ty, &tz, &sx, &sy, &sz}) {
+        v->resize(numJoints, 0.f);
+    }
+    for (auto* v : {&rx, &ry, &rz}) {
+        v->resize(numJoints, 0.f);
+    }
+    rw.resize(numJoints, 1.f);
+}
+
+void AffineTransforms::resize(std::size_t numJoints)
+{
+    for (auto& v : m) {
+        v.resize(numJoints);
+    }
+}
+
+void blendPoses(const SkeletonPose& a, const SkeletonPose& b, float t, SkeletonPose& out)
+{
+    assert(a.size() == b.size());
+    const auto n = a.size();
+    out.resize(n);
+
+    const auto lerp =
+        [n, t](const std::vector<float>& va, const std::vector<float>& vb, std::vector<float>& vo) {
+            for (std::size_t i = 0; i < n; ++i) {
+                vo[i] = va[i] + (vb[i] - va[i]) * t;
+            }
+        };
+    lerp(a.tx, b.tx, out.tx);
+    lerp(a.ty, b.ty, out.ty);
+    lerp(a.tz, b.tz, out.tz);
+    lerp(a.sx, b.sx, out.sx);
+    lerp(a.sy, b.sy, out.sy);
+    lerp(a.sz, b.sz, out.sz);
+
+    // nlerp - take the shortest path by flipping b if the quaternions are in
+    // different hemispheres
+    for (std::size_t i = 0; i < n; ++i) {
+        const float d =
+            a.rx[i] * b.rx[i] + a.ry[i] * b.ry[i] + a.rz[i] * b.rz[i] + a.rw[i] * b.rw[i];
+        const float tb = d < 0.f ? -t : t;
+        const float ta = 1.f - t;
+        const float x = a.rx[i] * ta + b.rx[i] * tb;
+        const float y = a.ry[i] * ta + b.ry[i] * tb;
+        const float z = a.rz[i] * ta + b.rz[i] * tb;
+        const float w = a.rw[i] * ta + b.rw[i] * tb;
+        const float invLen = 1.f / std::sqrt(x * x + y * y + z * z + w * w);
+        out.rx[i] = x * invLen;
+        out.ry[i] = y * invLen;
+        out.rz[i] = z * invLen;
+        out.rw[i] = w * invLen;
+    }
+}
+
+namespace
+{
+// local = T * R * S for each joint
+void computeLocalTransforms(const SkeletonPose& pose, AffineTransforms& local)
+{
+    const auto n = pose.size();
+    auto& m = local.m;
+    for (std::size_t i = 0; i < n; ++i) {
+        const float x = pose.rx[i], y = pose.ry[i], z = pose.rz[i], w = pose.rw[i];
+        const float xx = x * x, yy = y * y, zz = z * z;
+        const float xy = x * y, xz = x * z, yz = y * z;
+        const float wx = w * x, wy = w * y, wz = w * z;
+
+        m[0][i] = (1.f - 2.f * (yy + zz)) * pose.sx[i];
+        m[1][i] = (2.f * (xy - wz)) * pose.sy[i];
+        m[2][i] = (2.f * (xz + wy)) * pose.sz[i];
+        m[3][i] = pose.tx[i];
+
+        m[4][i] = (2.f * (xy + wz)) * pose.sx[i];
+        m[5][i] = (1.f - 2.f * (xx + zz)) * pose.sy[i];
+        m[6][i] = (2.f * (yz - wx)) * pose.sz[i];
+        m[7][i] = pose.ty[i];
+
+        m[8][i] = (2.f * (xz - wy)) * pose.sx[i];
+        m[9][i] = (2.f * (yz + wx)) * pose.sy[i];
+        m[10][i] = (1.f - 2.f * (xx + yy)) * pose.sz[i];
+        m[11][i] = pose.tz[i];
+    }
+}
+
+// out = a[ia] * b[ib] for a single joint
+void mulAffine(
+    const AffineTransforms& a,
+    std::size_t ia,
+    const AffineTransforms& b,
+    std::size_t ib,
+    float* out)
+{
+    for (int r = 0; r < 3; ++r) {
+        const float a0 = a.m[r * 4 + 0][ia];
+        const float a1 = a.m[r * 4 + 1][ia];
+        const float a2 = a.m[r * 4 + 2][ia];
+        for (int c = 0; c < 4; ++c) {
+            out[r * 4 + c] =
+                a0 * b.m[0 * 4 + c][ib] + a1 * b.m[1 * 4 + c][ib] + a2 * b.m[2 * 4 + c][ib];
+        }
+        out[r * 4 + 3] += a.m[r * 4 + 3][ia];
+    }
+}
+
+// out[i] = a[i] * b[i] for all joints - inner loops run over joints and vectorize
+void mulAffineAll(const AffineTransforms& a, const AffineTransforms& b, AffineTransforms& out)
+{
+    const auto n = a.size();
+    for (int r = 0; r < 3; ++r) {
+        const float* a0 = a.m[r * 4 + 0].data();
+        const float* a1 = a.m[r * 4 + 1].data();
+        const float* a2 = a.m[r * 4 + 2].data();
+        const float* a3 = a.m[r * 4 + 3].data();
+        for (int c = 0; c < 4; ++c) {
+            const float* b0 = b.m[0 * 4 + c].data();
+            const float* b1 = b.m[1 * 4 + c].data();
+            const float* b2 = b.m[2 * 4 + c].data();
+            float* o = out.m[r * 4 + c].data();
+            for (std::size_t i = 0; i < n; ++i) {
+                o[i] = a0[i] * b0[i] + a1[i] * b1[i] + a2[i] * b2[i];
+            }
+            if (c == 3) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    o[i] += a3[i];
+                }
+            }
+        }
+    }
+}
+}
+
+void computeJointPalette(
+    const Skeleton& skeleton,
+    const SkeletonPose& pose,
+    JointPaletteScratch& scratch,
+    glm::mat4* out)
+{
+    const auto n = skeleton.getNumJoints();
+    assert(pose.size() == n);
+    scratch.local.resize(n);
+    scratch.world.resize(n);
+
+    computeLocalTransforms(pose, scratch.local);
+
+    // world transforms - parents are always before children, so one pass is enough
+    float tmp[12];
+    const auto& root = skeleton.rootTransform;
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto parent = skeleton.parents[i];
+        if (parent < 0) {
+            const auto& local = scratch.local.m;
+            for (int r = 0; r < 3; ++r) {
+                for (int c = 0; c < 4; ++c) {
+                    scratch.world.m[r * 4 + c][i] = root[0][r] * local[0 * 4 + c][i] +
+                                                    root[1][r] * local[1 * 4 + c][i] +
+                                                    root[2][r] * local[2 * 4 + c][i] +
+                                                    (c == 3 ? root[3][r] : 0.f);
+                }
+            }
+        } else {
+            mulAffine(scratch.world, parent, scratch.local, i, tmp);
+            for (int k = 0; k < 12; ++k) {
+                scratch.world.m[k][i] = tmp[k];
+            }
+        }
+    }
+
+    // skinning matrices (local transforms are not needed anymore - reuse them)
+    auto& skin = scratch.local;
+    mulAffineAll(scratch.world, skeleton.inverseBindMatrices, skin);
+
+    // write as column-major mat4 for upload
+    for (std::size_t i = 0; i < n; ++i) {
+        auto& o = out[i];
+        for (int c = 0; c < 4; ++c) {
+            o[c][0] = skin.m[0 * 4 + c][i];
+            o[c][1] = skin.m[1 * 4 + c][i];
+            o[c][2] = skin.m[2 * 4 + c][i];
+            o[c][3] = c == 3 ? 1.f : 0.f;
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+// Joint transforms stored as SoA so that sampling, blending and
+// matrix computation are simple loops over float arrays which compilers
+// can vectorize (and which don't need glm objects per joint).
+struct SkeletonPose {
+    void resize(std::size_t numJoints);
+    std::size_t size() const { return tx.size(); }
+
+    // translation
+    std::vector<float> tx, ty, tz;
+    // rotation (quaternion)
+    std::vector<float> rx, ry, rz, rw;
+    // scale
+    std::vector<float> sx, sy, sz;
+};
+
+// Affine transforms (3x4, row-major) stored as SoA: m[row * 4 + col][joint]
+struct AffineTransforms {
+    void resize(std::size_t numJoints);
+    std::size_t size() const { return m[0].size(); }
+
+    std::vector<float> m[12];
+};
+
+struct Skeleton {
+    std::size_t getNumJoints() const { return parents.size(); }
+
+    // joints are sorted so that parents always come before their children
+    std::vector<std::int16_t> parents; // -1 for root joints
+    std::vector<std::string> jointNames;
+
+    AffineTransforms inverseBindMatrices;
+    SkeletonPose restPose;
+
+    // model space transform of whatever root joints are attached to (e.g. an armature node)
+    glm::mat4 rootTransform{1.f};
+};
+
+// out = lerp(a, b, t) with nlerp for rotations
+void blendPoses(const SkeletonPose& a, const SkeletonPose& b, float t, SkeletonPose& out);
+
+// Scratch buffers for computeJointPalette, can be reused between calls
+struct JointPaletteScratch {
+    AffineTransforms local;
+    AffineTransforms world;
+};
+
+// Computes skinning matrices (world joint transform * inverse bind matrix)
+// for all joints. `out` should point to skeleton.getNumJoints() matrices.
+void computeJointPalette(
+    const Skeleton& skeleton,
+    const SkeletonPose& pose,
+    JointPaletteScratch& scratch,
+    glm::mat4* out);
@@ -0,0 +1,54 @@
+#include "UniformBufferRing.h"
+
+#include <algorithm>
+
+#include <Platform/gl.h>
+
+void UniformBufferRing::init(std::size_t frameCapacity)
+{
+    GLint offsetAlignment{0};
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    alignment = std::max<std::size_t>(offsetAlignment, 16);
+
+    this->frameCapacity = (frameCapacity + alignment - 1) / alignment * alignment;
+    buffer = GLBuffer::create();
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+    glBufferData(GL_UNIFORM_BUFFER, this->frameCapacity * NUM_FRAMES, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBufferRing::beginFrame()
+{
+    staging.clear();
+    frameIndex = (frameIndex + 1) % NUM_FRAMES;
+}
+
+std::size_t UniformBufferRing::allocate(std::size_t size)
+{
+    const auto offset = (staging.size() + alignment - 1) / alignment * alignment;
+    staging.resize(offset + size);
+    return offset;
+}
+
+void UniformBufferRing::upload()
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+    if (staging.size() > frameCapacity) {
+        // the old buffer can still be in use, GL keeps its storage alive until it's not
+        frameCapacity = (staging.size() * 2 + alignment - 1) / alignment * alignment;
+        glBufferData(GL_UNIFORM_BUFFER, frameCapacity * NUM_FRAMES, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(
+        GL_UNIFORM_BUFFER, frameIndex * frameCapacity, staging.size(), staging.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBufferRing::bindRange(UniformBlock block, std::size_t offset, std::size_t size) const
+{
+    glBindBufferRange(
+        GL_UNIFORM_BUFFER,
+        static_cast<GLuint>(block),
+        buffer.get(),
+        frameIndex * frameCapacity + offset,
+        size);
+}
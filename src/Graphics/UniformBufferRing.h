@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <Graphics/GLHandle.h>
+#include <Graphics/ShaderUniforms.h>
+
+// Uniform data for a frame is gathered on the CPU and uploaded with a single
+// glBufferSubData call into one of several regions of a buffer (so that the GPU can
+// still read the previous frames' data). Draws bind their part with glBindBufferRange.
+class UniformBufferRing {
+public:
+    void init(std::size_t frameCapacity);
+
+    // starts gathering data for a new frame
+    void beginFrame();
+
+    // returns the offset to pass to bindRange, aligned as GL requires
+    std::size_t allocate(std::size_t size);
+    std::uint8_t* getData(std::size_t offset) { return &staging[offset]; }
+
+    template<typename T>
+    std::size_t push(const T& v)
+    {
+        const auto offset = allocate(sizeof(T));
+        std::memcpy(getData(offset), &v, sizeof(T));
+        return offset;
+    }
+
+    // uploads everything allocated since beginFrame (grows the buffer if needed)
+    void upload();
+
+    void bindRange(UniformBlock block, std::size_t offset, std::size_t size) const;
+
+private:
+    static constexpr std::size_t NUM_FRAMES = 3;
+
+    GLBuffer buffer;
+    std::size_t frameCapacity{0};
+    std::size_t alignment{256};
+    std::size_t frameIndex{0};
+    std::vector<std::uint8_t> staging;
+};
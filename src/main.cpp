@@ -1,10 +1,25 @@
 #include "Game.h"
 
+#include <cstring>
+
+#include <util/Log.h>
+
 int main(int argc, char* args[])
 {
+    Game::Params params;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--render-thread") == 0) {
+            params.renderThread = true;
+        }
+    }
+
+    util::startLogWriter();
+
     Game game;
-    game.start();
+    game.start(params);
     game.loop();
 
+    util::stopLogWriter();
+
     return 0;
 }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Asset pack layout (all integers are little-endian):
+//
+//   AssetPackHeader
+//   AssetPackEntry[numEntries]   - sorted by name
+//   names                        - not null-terminated, referenced by entries
+//   data                         - each entry starts at ASSET_PACK_ALIGNMENT
+//
+// Entries which are stored uncompressed can be used directly from the mapped pack.
+
+inline constexpr std::uint32_t ASSET_PACK_MAGIC = 0x4b504d45; // "EMPK"
+inline constexpr std::uint32_t ASSET_PACK_VERSION = 1;
+inline constexpr std::uint64_t ASSET_PACK_ALIGNMENT = 16;
+
+enum class AssetPackCompression : std::uint32_t {
+    None = 0,
+    LZ4 = 1, // LZ4 block format
+};
+
+struct AssetPackHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t numEntries;
+    std::uint32_t namesSize;
+};
+
+struct AssetPackEntry {
+    std::uint64_t offset; // from the start of the pack
+    std::uint64_t storedSize;
+    std::uint64_t size; // uncompressed
+    std::uint32_t nameOffset; // from the start of names
+    std::uint32_t nameLength;
+    AssetPackCompression compression;
+    std::uint32_t padding;
+};
+
+static_assert(sizeof(AssetPackHeader) == 16);
+static_assert(sizeof(AssetPackEntry) == 40);
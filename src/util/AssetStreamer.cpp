@@ -0,0 +1,167 @@
+#include "AssetStreamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <util/VirtualFS.h>
+#include <util/Log.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/fetch.h>
+#endif
+
+namespace
+{
+#ifdef __EMSCRIPTEN__
+bool writeToMEMFS(const std::filesystem::path& path, const emscripten_fetch_t& fetch)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    std::ofstream f(path, std::ios::binary);
+    f.write(fetch.data, static_cast<std::streamsize>(fetch.numBytes));
+    return static_cast<bool>(f);
+}
+#endif
+} // end of anonymous namespace
+
+namespace util
+{
+AssetStreamer::AssetStreamer(std::size_t maxConcurrentRequests) :
+    maxConcurrentRequests(maxConcurrentRequests)
+{
+    assert(maxConcurrentRequests > 0);
+}
+
+AssetStreamer::~AssetStreamer()
+{
+    for (auto& request : started) {
+        cancelRequest(request);
+    }
+}
+
+AssetStreamer::RequestId AssetStreamer::request(
+    std::filesystem::path path,
+    Priority priority,
+    Callback callback)
+{
+    const auto id = nextId++;
+    queued.push_back(Request{
+        .id = id,
+        .path = std::move(path),
+        .priority = priority,
+        .callback = std::move(callback),
+    });
+    return id;
+}
+
+void AssetStreamer::cancel(RequestId id)
+{
+    const auto hasId = [id](const Request& r) { return r.id == id; };
+    if (auto it = std::find_if(queued.begin(), queued.end(), hasId); it != queued.end()) {
+        queued.erase(it);
+        return;
+    }
+    if (auto it = std::find_if(started.begin(), started.end(), hasId); it != started.end()) {
+        cancelRequest(*it);
+        started.erase(it);
+    }
+}
+
+void AssetStreamer::update()
+{
+    // start as many requests as we can, highest priority first
+    while (!queued.empty() && started.size() < maxConcurrentRequests) {
+        auto it = std::max_element(
+            queued.begin(), queued.end(), [](const Request& a, const Request& b) {
+                return a.priority < b.priority;
+            });
+        started.push_back(std::move(*it));
+        queued.erase(it);
+        startRequest(started.back());
+    }
+
+    // callbacks can make new requests, so move finished ones out first
+    std::vector<Request> finished;
+    for (auto it = started.begin(); it != started.end();) {
+        if (it->finished) {
+            finished.push_back(std::move(*it));
+            it = started.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (const auto& request : finished) {
+        if (!request.ok) {
+            LOG_ERROR("Failed to stream asset '%s'", request.path.string().c_str());
+        }
+        request.callback(request.path, request.ok);
+    }
+}
+
+void AssetStreamer::finishAll()
+{
+#ifdef __EMSCRIPTEN__
+    assert(false && "fetches only complete when control returns to the browser");
+#else
+    while (getNumPending() != 0) {
+        update();
+    }
+#endif
+}
+
+#ifdef __EMSCRIPTEN__
+void AssetStreamer::startRequest(Request& request)
+{
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+    std::strcpy(attr.requestMethod, "GET");
+    attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+    attr.userData = this;
+    attr.onsuccess = &AssetStreamer::onFetchFinished;
+    attr.onerror = &AssetStreamer::onFetchFinished;
+
+    // files are served next to index.html with the same relative paths
+    request.fetch = emscripten_fetch(&attr, request.path.generic_string().c_str());
+}
+
+void AssetStreamer::cancelRequest(Request& request)
+{
+    // reset first so that onFetchFinished called by the abort ignores the request
+    if (auto* fetch = std::exchange(request.fetch, nullptr)) {
+        emscripten_fetch_close(fetch);
+    }
+}
+
+void AssetStreamer::onFetchFinished(emscripten_fetch_t* fetch)
+{
+    auto& self = *static_cast<AssetStreamer*>(fetch->userData);
+    auto it = std::find_if(self.started.begin(), self.started.end(), [fetch](const Request& r) {
+        return r.fetch == fetch;
+    });
+    if (it == self.started.end()) {
+        return; // cancelled
+    }
+
+    it->ok = fetch->status == 200 && writeToMEMFS(it->path, *fetch);
+    it->finished = true;
+    it->fetch = nullptr;
+    emscripten_fetch_close(fetch);
+}
+#else
+void AssetStreamer::startRequest(Request& request)
+{
+    // already in the mounted packs (or on disk)
+    request.ok = assetFileExists(request.path);
+    request.finished = true;
+}
+
+void AssetStreamer::cancelRequest(Request& request)
+{}
+#endif
+
+} // end of namespace util
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+struct emscripten_fetch_t;
+#endif
+
+namespace util
+{
+// Loads assets which are not part of the boot pack on demand.
+// On the web files are downloaded with the Fetch API and written to MEMFS,
+// so that they can be read with readAssetFile once the callback is called.
+// On native everything is already local and requests complete on the next update().
+class AssetStreamer {
+public:
+    using RequestId = std::uint32_t;
+    // called from update(), ok is false if the file couldn't be loaded
+    using Callback = std::function<void(const std::filesystem::path& path, bool ok)>;
+
+    enum class Priority {
+        Low,
+        Normal,
+        High, // needed to show something which is already in the scene
+    };
+
+    explicit AssetStreamer(std::size_t maxConcurrentRequests = 4);
+    ~AssetStreamer();
+
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    RequestId request(std::filesystem::path path, Priority priority, Callback callback);
+    // the callback won't be called, downloads in progress are aborted
+    void cancel(RequestId id);
+
+    // Starts queued requests (highest priority first) and calls callbacks of
+    // finished ones. Callbacks can make new requests.
+    void update();
+    // Native only (blocks forever on the web): completes all pending requests,
+    // including the ones made by callbacks
+    void finishAll();
+
+    std::size_t getNumPending() const { return queued.size() + started.size(); }
+
+private:
+    struct Request {
+        RequestId id;
+        std::filesystem::path path;
+        Priority priority;
+        Callback callback;
+        bool finished{false};
+        bool ok{false};
+#ifdef __EMSCRIPTEN__
+        emscripten_fetch_t* fetch{nullptr};
+#endif
+    };
+
+    void startRequest(Request& request);
+    void cancelRequest(Request& request);
+
+#ifdef __EMSCRIPTEN__
+    static void onFetchFinished(emscripten_fetch_t* fetch);
+#endif
+
+    std::size_t maxConcurrentRequests;
+    RequestId nextId{1};
+    std::vector<Request> queued; // in the order of requests
+    std::vector<Request> started;
+};
+}
@@ -0,0 +1,239 @@
+#include "CookedModel.h"
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <Graphics/ModelData.h>
+#include <Graphics/ShaderUniforms.h>
+
+namespace
+{
+constexpr std::uint32_t COOKED_MODEL_MAGIC = 0x4c444d45; // "EMDL"
+// bump when ModelData, MeshData::Vertex or anything else written here changes
+constexpr std::uint32_t COOKED_MODEL_VERSION = 2;
+
+class Writer {
+public:
+    template<typename T>
+    void write(const T& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(&v);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    void writeArray(const std::vector<T>& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write(static_cast<std::uint64_t>(v.size()));
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(v.data());
+        data.insert(data.end(), bytes, bytes + v.size() * sizeof(T));
+    }
+
+    void writeString(const std::string& s)
+    {
+        write(static_cast<std::uint64_t>(s.size()));
+        data.insert(data.end(), s.begin(), s.end());
+    }
+
+    std::vector<std::uint8_t> data;
+};
+
+class Reader {
+public:
+    explicit Reader(std::span<const std::uint8_t> data) : data(data) {}
+
+    template<typename T>
+    bool read(T& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (data.size() - offset < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&v, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    template<typename T>
+    bool readArray(std::vector<T>& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::uint64_t size;
+        if (!read(size) || size > (data.size() - offset) / sizeof(T)) {
+            return false;
+        }
+        v.resize(size);
+        std::memcpy(v.data(), data.data() + offset, size * sizeof(T));
+        offset += size * sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& s)
+    {
+        std::uint64_t size;
+        if (!read(size) || size > data.size() - offset) {
+            return false;
+        }
+        s.assign(reinterpret_cast<const char*>(data.data() + offset), size);
+        offset += size;
+        return true;
+    }
+
+private:
+    std::span<const std::uint8_t> data;
+    std::size_t offset{0};
+};
+
+// calls f for every SoA array of the pose, stops if it returns false
+template<typename Pose, typename Func>
+bool forEachPoseArray(Pose& pose, Func&& f)
+{
+    for (auto* v :
+         {&pose.tx, &pose.ty, &pose.tz, &pose.rx, &pose.ry, &pose.rz, &pose.rw, &pose.sx, &pose.sy,
+          &pose.sz}) {
+        if (!f(*v)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+bool isCookedModel(std::span<const std::uint8_t> data)
+{
+    std::uint32_t magic;
+    if (data.size() < sizeof(magic)) {
+        return false;
+    }
+    std::memcpy(&magic, data.data(), sizeof(magic));
+    return magic == COOKED_MODEL_MAGIC;
+}
+
+std::vector<std::uint8_t> writeCookedModel(const ModelData& model)
+{
+    Writer w;
+    w.write(COOKED_MODEL_MAGIC);
+    w.write(COOKED_MODEL_VERSION);
+
+    w.write(model.position);
+    w.write(model.rotation);
+    w.write(model.scale);
+
+    w.write(static_cast<std::uint32_t>(model.meshes.size()));
+    for (const auto& mesh : model.meshes) {
+        w.writeString(mesh.name);
+        w.writeString(mesh.materialPath);
+        w.write(mesh.boundsMin);
+        w.write(mesh.boundsMax);
+        w.writeArray(mesh.vertices);
+        w.writeArray(mesh.indices);
+        w.writeArray(mesh.skinVertices);
+    }
+
+    const auto& skeleton = model.skeleton;
+    w.writeArray(skeleton.parents);
+    for (const auto& name : skeleton.jointNames) {
+        w.writeString(name);
+    }
+    for (const auto& m : skeleton.inverseBindMatrices.m) {
+        w.writeArray(m);
+    }
+    forEachPoseArray(skeleton.restPose, [&w](const std::vector<float>& v) {
+        w.writeArray(v);
+        return true;
+    });
+    w.write(skeleton.rootTransform);
+
+    w.write(static_cast<std::uint32_t>(model.animations.size()));
+    for (const auto& clip : model.animations) {
+        w.writeString(clip.name);
+        w.write(clip.duration);
+        w.write(static_cast<std::uint32_t>(clip.tracks.size()));
+        for (const auto& track : clip.tracks) {
+            w.write(track.joint);
+            w.write(track.path);
+            w.write(track.step);
+            w.writeArray(track.times);
+            w.writeArray(track.values);
+        }
+    }
+
+    return std::move(w.data);
+}
+
+bool readCookedModel(std::span<const std::uint8_t> data, ModelData& model)
+{
+    Reader r(data);
+    std::uint32_t magic;
+    std::uint32_t version;
+    if (!r.read(magic) || magic != COOKED_MODEL_MAGIC || !r.read(version) ||
+        version != COOKED_MODEL_VERSION) {
+        return false;
+    }
+
+    std::uint32_t numMeshes;
+    if (!r.read(model.position) || !r.read(model.rotation) || !r.read(model.scale) ||
+        !r.read(numMeshes)) {
+        return false;
+    }
+
+    model.meshes.resize(numMeshes);
+    for (auto& mesh : model.meshes) {
+        if (!r.readString(mesh.name) || !r.readString(mesh.materialPath) ||
+            !r.read(mesh.boundsMin) || !r.read(mesh.boundsMax) || !r.readArray(mesh.vertices) ||
+            !r.readArray(mesh.indices) || !r.readArray(mesh.skinVertices)) {
+            return false;
+        }
+    }
+
+    // the skinning shader has a fixed number of joint matrices
+    auto& skeleton = model.skeleton;
+    if (!r.readArray(skeleton.parents) || skeleton.parents.size() > MAX_JOINTS) {
+        return false;
+    }
+    skeleton.jointNames.resize(skeleton.parents.size());
+    for (auto& name : skeleton.jointNames) {
+        if (!r.readString(name)) {
+            return false;
+        }
+    }
+    for (auto& m : skeleton.inverseBindMatrices.m) {
+        if (!r.readArray(m)) {
+            return false;
+        }
+    }
+    const auto readPoseArray = [&r](std::vector<float>& v) { return r.readArray(v); };
+    if (!forEachPoseArray(skeleton.restPose, readPoseArray) ||
+        skeleton.restPose.size() != skeleton.getNumJoints() || !r.read(skeleton.rootTransform)) {
+        return false;
+    }
+
+    std::uint32_t numAnimations;
+    if (!r.read(numAnimations)) {
+        return false;
+    }
+    model.animations.resize(numAnimations);
+    for (auto& clip : model.animations) {
+        std::uint32_t numTracks;
+        if (!r.readString(clip.name) || !r.read(clip.duration) || !r.read(numTracks)) {
+            return false;
+        }
+        clip.tracks.resize(numTracks);
+        for (auto& track : clip.tracks) {
+            if (!r.read(track.joint) || !r.read(track.path) || !r.read(track.step) ||
+                !r.readArray(track.times) || !r.readArray(track.values)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+} // end of namespace util
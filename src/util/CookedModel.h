@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct ModelData;
+
+namespace util
+{
+// Cooked models are produced by the asset packer from glTF files. They're a flat
+// dump of ModelData which can be loaded without parsing JSON, so shipping
+// builds don't need the glTF loader at all.
+bool isCookedModel(std::span<const std::uint8_t> data);
+
+std::vector<std::uint8_t> writeCookedModel(const ModelData& model);
+// Returns false if the data is malformed or was written by a different version
+bool readCookedModel(std::span<const std::uint8_t> data, ModelData& model);
+}
@@ -0,0 +1,217 @@
+#include "EntityRegistry.h"
+
+#include <atomic>
+#include <bit>
+#include <new>
+
+namespace util
+{
+namespace
+{
+std::byte* allocateColumn(std::size_t size, std::size_t alignment)
+{
+    return static_cast<std::byte*>(::operator new(size, std::align_val_t{alignment}));
+}
+
+void freeColumn(std::byte* data, std::size_t alignment)
+{
+    ::operator delete(data, std::align_val_t{alignment});
+}
+
+} // end of anonymous namespace
+
+EntityRegistry::Archetype::~Archetype()
+{
+    for (auto& column : columns) {
+        freeColumn(column.data, column.info.alignment);
+    }
+}
+
+std::byte* EntityRegistry::Archetype::getColumn(ComponentId id) const
+{
+    const auto index = columnIndices[id];
+    return index == NO_COLUMN ? nullptr : columns[index].data;
+}
+
+void EntityRegistry::Archetype::reserve(std::size_t n)
+{
+    if (n <= capacity) {
+        return;
+    }
+    // grow geometrically, so that adding entities one by one doesn't reallocate every time
+    const auto newCapacity = std::max({n, capacity * 2, std::size_t{16}});
+    for (auto& column : columns) {
+        auto* data = allocateColumn(newCapacity * column.info.size, column.info.alignment);
+        if (column.data) {
+            std::memcpy(data, column.data, size() * column.info.size);
+            freeColumn(column.data, column.info.alignment);
+        }
+        column.data = data;
+    }
+    entities.reserve(newCapacity);
+    capacity = newCapacity;
+}
+
+std::size_t EntityRegistry::Archetype::addRows(std::size_t n)
+{
+    const auto first = size();
+    reserve(first + n);
+    entities.resize(first + n);
+    return first;
+}
+
+Entity EntityRegistry::Archetype::removeRow(std::size_t row)
+{
+    const auto last = size() - 1;
+    Entity moved;
+    if (row != last) {
+        for (auto& column : columns) {
+            std::memcpy(column.get(row), column.get(last), column.info.size);
+        }
+        moved = entities[last];
+        entities[row] = moved;
+    }
+    entities.pop_back();
+    return moved;
+}
+
+EntityRegistry::EntityRegistry()
+{
+    // entities without components
+    getOrCreateArchetype(0);
+}
+
+EntityRegistry::~EntityRegistry() = default;
+
+ComponentId EntityRegistry::registerComponentId()
+{
+    static std::atomic<ComponentId> nextId{0};
+    const auto id = nextId++;
+    assert(id < MAX_COMPONENTS && "too many component types");
+    return id;
+}
+
+std::uint32_t EntityRegistry::getOrCreateArchetype(ComponentMask mask)
+{
+    if (const auto it = archetypeIndices.find(mask); it != archetypeIndices.end()) {
+        return it->second;
+    }
+
+    auto archetype = std::make_unique<Archetype>();
+    archetype->mask = mask;
+    archetype->columnIndices.fill(NO_COLUMN);
+    for (auto bits = mask; bits != 0; bits &= bits - 1) {
+        const auto id = static_cast<ComponentId>(std::countr_zero(bits));
+        assert(componentInfos[id].size != 0 && "component wasn't registered");
+        archetype->columnIndices[id] = static_cast<std::uint8_t>(archetype->columns.size());
+        archetype->columns.push_back(Column{.id = id, .info = componentInfos[id]});
+    }
+
+    const auto index = static_cast<std::uint32_t>(archetypes.size());
+    archetypes.push_back(std::move(archetype));
+    archetypeIndices.emplace(mask, index);
+    return index;
+}
+
+std::size_t EntityRegistry::createEntities(std::uint32_t archetypeIndex, std::span<Entity> entities)
+{
+    auto& archetype = *archetypes[archetypeIndex];
+    const auto first = archetype.addRows(entities.size());
+    for (std::size_t i = 0; i < entities.size(); ++i) {
+        std::uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            index = static_cast<std::uint32_t>(slots.size());
+            slots.emplace_back();
+        }
+        auto& slot = slots[index];
+        slot.archetype = archetypeIndex;
+        slot.row = static_cast<std::uint32_t>(first + i);
+        slot.isAlive = true;
+
+        const Entity e{.index = index, .generation = slot.generation};
+        archetype.entities[first + i] = e;
+        entities[i] = e;
+    }
+    numEntities += entities.size();
+    return first;
+}
+
+void EntityRegistry::destroy(Entity e)
+{
+    assert(isAlive(e));
+    auto& slot = slots[e.index];
+    const auto moved = archetypes[slot.archetype]->removeRow(slot.row);
+    if (moved.isValid()) {
+        slots[moved.index].row = slot.row;
+    }
+    slot.isAlive = false;
+    ++slot.generation;
+    freeSlots.push_back(e.index);
+    --numEntities;
+}
+
+void EntityRegistry::destroy(std::span<const Entity> entities)
+{
+    freeSlots.reserve(freeSlots.size() + entities.size());
+    for (const auto& e : entities) {
+        destroy(e);
+    }
+}
+
+void EntityRegistry::clear()
+{
+    for (auto& archetype : archetypes) {
+        for (const auto& e : archetype->entities) {
+            auto& slot = slots[e.index];
+            slot.isAlive = false;
+            ++slot.generation;
+            freeSlots.push_back(e.index);
+        }
+        archetype->entities.clear();
+    }
+    numEntities = 0;
+}
+
+bool EntityRegistry::isAlive(Entity e) const
+{
+    return e.index < slots.size() && slots[e.index].isAlive &&
+           slots[e.index].generation == e.generation;
+}
+
+std::size_t EntityRegistry::moveEntity(Entity e, ComponentMask newMask)
+{
+    auto& slot = slots[e.index];
+    const auto newIndex = getOrCreateArchetype(newMask);
+    // getOrCreateArchetype can reallocate archetypes, so take references after it
+    auto& src = *archetypes[slot.archetype];
+    auto& dst = *archetypes[newIndex];
+
+    const auto row = dst.addRows(1);
+    dst.entities[row] = e;
+    for (const auto& column : dst.columns) {
+        if (const auto* data = src.getColumn(column.id)) {
+            std::memcpy(column.get(row), data + slot.row * column.info.size, column.info.size);
+        }
+    }
+
+    const auto moved = src.removeRow(slot.row);
+    if (moved.isValid()) {
+        slots[moved.index].row = slot.row;
+    }
+    slot.archetype = newIndex;
+    slot.row = static_cast<std::uint32_t>(row);
+    return row;
+}
+
+std::byte* EntityRegistry::getComponent(Entity e, ComponentId id) const
+{
+    assert(isAlive(e));
+    const auto& slot = slots[e.index];
+    const auto* column = archetypes[slot.archetype]->getColumn(id);
+    return column ? const_cast<std::byte*>(column) + slot.row * componentInfos[id].size : nullptr;
+}
+
+}
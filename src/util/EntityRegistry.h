@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace util
+{
+// Stable handle, the index is reused after the entity is destroyed, the generation isn't
+struct Entity {
+    static constexpr std::uint32_t INVALID_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t index{INVALID_INDEX};
+    std::uint32_t generation{0};
+
+    bool isValid() const { return index != INVALID_INDEX; }
+    bool operator==(const Entity&) const = default;
+};
+
+using ComponentId = std::uint32_t;
+using ComponentMask = std::uint64_t;
+
+// Archetype-based entity/component store.
+// Entities with the same set of components live in one archetype which keeps each
+// component in a contiguous column, so systems iterate over plain arrays. Components
+// have to be trivially copyable (they're moved between archetypes with memcpy).
+// Adding or removing components moves the entity to another archetype, which
+// invalidates pointers to components, so structural changes shouldn't happen
+// while iterating. Not thread-safe, but different columns and disjoint ranges
+// of a chunk can be processed in parallel.
+class EntityRegistry {
+public:
+    static constexpr std::size_t MAX_COMPONENTS = 64;
+
+    EntityRegistry();
+    ~EntityRegistry();
+
+    EntityRegistry(const EntityRegistry&) = delete;
+    EntityRegistry& operator=(const EntityRegistry&) = delete;
+
+    template<typename... Ts>
+    Entity create(const Ts&... components);
+    // creates entities.size() entities with the same components, all at once
+    template<typename... Ts>
+    void createMany(std::span<Entity> entities, const Ts&... components);
+
+    void destroy(Entity e);
+    void destroy(std::span<const Entity> entities);
+    void clear();
+
+    bool isAlive(Entity e) const;
+
+    template<typename T>
+    bool has(Entity e) const;
+    template<typename T>
+    T& get(Entity e);
+    template<typename T>
+    const T& get(Entity e) const;
+    // returns nullptr if the entity doesn't have the component
+    template<typename T>
+    T* tryGet(Entity e);
+
+    // adds the component or overwrites the existing one
+    template<typename T>
+    T& add(Entity e, const T& component);
+    template<typename T>
+    void remove(Entity e);
+
+    // Calls f(entities, columns...) for each archetype which has all of Ts, with
+    // std::span<const Entity> and std::span<T> of the same size
+    template<typename... Ts, typename F>
+    void forEachChunk(F&& f);
+    // calls f(entity, components&...) for each entity which has all of Ts
+    template<typename... Ts, typename F>
+    void forEach(F&& f);
+    template<typename... Ts>
+    std::size_t count();
+
+    std::size_t getNumEntities() const { return numEntities; }
+    // all entity indices are less than this (e.g. for arrays indexed by Entity::index)
+    std::size_t getNumSlots() const { return slots.size(); }
+    std::size_t getNumArchetypes() const { return archetypes.size(); }
+
+    template<typename T>
+    static ComponentId getComponentId();
+
+private:
+    struct ComponentInfo {
+        std::size_t size{0};
+        std::size_t alignment{0};
+    };
+
+    struct Column {
+        ComponentId id;
+        ComponentInfo info;
+        std::byte* data{nullptr};
+
+        std::byte* get(std::size_t row) const { return data + row * info.size; }
+    };
+
+    struct Archetype {
+        ComponentMask mask{0};
+        std::vector<Column> columns; // sorted by id
+        // index in columns for each component id, NO_COLUMN if it's not in the archetype
+        std::array<std::uint8_t, MAX_COMPONENTS> columnIndices;
+        std::vector<Entity> entities; // row -> entity
+        std::size_t capacity{0};
+
+        ~Archetype();
+
+        std::size_t size() const { return entities.size(); }
+        // returns nullptr if the archetype doesn't have the component
+        std::byte* getColumn(ComponentId id) const;
+        void reserve(std::size_t n);
+        // returns the index of the first new row, components are uninitialized
+        std::size_t addRows(std::size_t n);
+        // moves the last row into the removed one, returns the moved entity (if any)
+        Entity removeRow(std::size_t row);
+    };
+
+    struct Slot {
+        std::uint32_t archetype{0};
+        std::uint32_t row{0};
+        std::uint32_t generation{0};
+        bool isAlive{false};
+    };
+
+    static constexpr std::uint8_t NO_COLUMN = std::numeric_limits<std::uint8_t>::max();
+
+    static ComponentId registerComponentId();
+
+    template<typename T>
+    ComponentId registerComponent();
+
+    std::uint32_t getOrCreateArchetype(ComponentMask mask);
+    // creates entities.size() entities with uninitialized components and returns the first row
+    std::size_t createEntities(std::uint32_t archetype, std::span<Entity> entities);
+    // moves the entity to the archetype with the given mask, keeping the shared
+    // components, returns the new row
+    std::size_t moveEntity(Entity e, ComponentMask newMask);
+    std::byte* getComponent(Entity e, ComponentId id) const;
+
+    template<typename... Ts>
+    static ComponentMask makeMask()
+    {
+        return (ComponentMask{0} | ... | (ComponentMask{1} << getComponentId<Ts>()));
+    }
+
+    std::array<ComponentInfo, MAX_COMPONENTS> componentInfos;
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::unordered_map<ComponentMask, std::uint32_t> archetypeIndices;
+    std::vector<Slot> slots;
+    std::vector<std::uint32_t> freeSlots;
+    std::size_t numEntities{0};
+};
+
+template<typename T>
+ComponentId EntityRegistry::getComponentId()
+{
+    static const auto id = registerComponentId();
+    return id;
+}
+
+template<typename T>
+ComponentId EntityRegistry::registerComponent()
+{
+    static_assert(
+        std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+        "components are moved with memcpy and never destroyed");
+    const auto id = getComponentId<T>();
+    componentInfos[id] = ComponentInfo{.size = sizeof(T), .alignment = alignof(T)};
+    return id;
+}
+
+template<typename... Ts>
+Entity EntityRegistry::create(const Ts&... components)
+{
+    Entity e;
+    createMany(std::span<Entity>{&e, 1}, components...);
+    return e;
+}
+
+template<typename... Ts>
+void EntityRegistry::createMany(std::span<Entity> entities, const Ts&... components)
+{
+    (registerComponent<Ts>(), ...);
+    const auto archetypeIndex = getOrCreateArchetype(makeMask<Ts...>());
+    const auto first = createEntities(archetypeIndex, entities);
+    const auto& archetype = *archetypes[archetypeIndex];
+    const auto fill = [&archetype, first, count = entities.size()]<typename T>(const T& c) {
+        auto* column = reinterpret_cast<T*>(archetype.getColumn(getComponentId<T>())) + first;
+        std::fill_n(column, count, c);
+    };
+    (fill(components), ...);
+}
+
+template<typename T>
+bool EntityRegistry::has(Entity e) const
+{
+    return getComponent(e, getComponentId<T>()) != nullptr;
+}
+
+template<typename T>
+T& EntityRegistry::get(Entity e)
+{
+    auto* c = getComponent(e, getComponentId<T>());
+    assert(c && "the entity doesn't have the component");
+    return *reinterpret_cast<T*>(c);
+}
+
+template<typename T>
+const T& EntityRegistry::get(Entity e) const
+{
+    const auto* c = getComponent(e, getComponentId<T>());
+    assert(c && "the entity doesn't have the component");
+    return *reinterpret_cast<const T*>(c);
+}
+
+template<typename T>
+T* EntityRegistry::tryGet(Entity e)
+{
+    return reinterpret_cast<T*>(getComponent(e, getComponentId<T>()));
+}
+
+template<typename T>
+T& EntityRegistry::add(Entity e, const T& component)
+{
+    const auto id = registerComponent<T>();
+    assert(isAlive(e));
+    auto* c = getComponent(e, id);
+    if (!c) {
+        const auto& slot = slots[e.index];
+        moveEntity(e, archetypes[slot.archetype]->mask | (ComponentMask{1} << id));
+        c = getComponent(e, id);
+    }
+    std::memcpy(c, &component, sizeof(T));
+    return *reinterpret_cast<T*>(c);
+}
+
+template<typename T>
+void EntityRegistry::remove(Entity e)
+{
+    assert(isAlive(e));
+    const auto id = getComponentId<T>();
+    const auto mask = archetypes[slots[e.index].archetype]->mask;
+    if (mask & (ComponentMask{1} << id)) {
+        moveEntity(e, mask & ~(ComponentMask{1} << id));
+    }
+}
+
+template<typename... Ts, typename F>
+void EntityRegistry::forEachChunk(F&& f)
+{
+    const auto mask = makeMask<Ts...>();
+    for (const auto& archetype : archetypes) {
+        if ((archetype->mask & mask) != mask || archetype->size() == 0) {
+            continue;
+        }
+        const auto n = archetype->size();
+        f(std::span<const Entity>{archetype->entities},
+          std::span<Ts>{reinterpret_cast<Ts*>(archetype->getColumn(getComponentId<Ts>())), n}...);
+    }
+}
+
+template<typename... Ts, typename F>
+void EntityRegistry::forEach(F&& f)
+{
+    forEachChunk<Ts...>([&f](std::span<const Entity> entities, std::span<Ts>... columns) {
+        for (std::size_t i = 0; i < entities.size(); ++i) {
+            f(entities[i], columns[i]...);
+        }
+    });
+}
+
+template<typename... Ts>
+std::size_t EntityRegistry::count()
+{
+    std::size_t n = 0;
+    forEachChunk<Ts...>([&n](std::span<const Entity> entities, auto...) { n += entities.size(); });
+    return n;
+}
+
+}
@@ -0,0 +1,94 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+
+#include <util/Log.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+std::filesystem::file_time_type getLastWriteTime(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type{} : time;
+}
+}
+
+namespace util
+{
+FileWatcher::FileWatcher(std::filesystem::path dir) : dir(std::move(dir))
+{
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd == -1) {
+        LOG_WARN("Failed to init inotify, falling back to polling");
+        return;
+    }
+    watchDescriptor = inotify_add_watch(
+        inotifyFd, this->dir.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watchDescriptor == -1) {
+        LOG_ERROR("Failed to watch '%s'", this->dir.string().c_str());
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (inotifyFd != -1) {
+        close(inotifyFd);
+    }
+#endif
+}
+
+void FileWatcher::addFile(const std::filesystem::path& filename)
+{
+    files.emplace(filename.string(), getLastWriteTime(dir / filename));
+}
+
+std::vector<std::filesystem::path> FileWatcher::pollChanges()
+{
+    std::vector<std::filesystem::path> changed;
+#if defined(__EMSCRIPTEN__)
+    return changed;
+#else
+#ifdef __linux__
+    if (watchDescriptor != -1) {
+        alignas(inotify_event) char buf[4096];
+        while (true) {
+            const auto len = read(inotifyFd, buf, sizeof(buf));
+            if (len <= 0) {
+                break;
+            }
+            for (const char* ptr = buf; ptr < buf + len;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                if (event->len > 0 && files.contains(event->name)) {
+                    const auto path = dir / event->name;
+                    // editors can send several events per save
+                    if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+                        changed.push_back(path);
+                    }
+                }
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+        return changed;
+    }
+#endif
+    for (auto& [filename, lastWriteTime] : files) {
+        const auto path = dir / filename;
+        const auto time = getLastWriteTime(path);
+        if (time != lastWriteTime) {
+            lastWriteTime = time;
+            changed.push_back(path);
+        }
+    }
+    return changed;
+#endif
+}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+namespace util
+{
+// Watches files inside a single directory for modifications.
+// Uses inotify on Linux (watching the directory, so that editors which save
+// by renaming a temp file are handled too) and polls modification times on
+// other platforms. Does nothing on the web.
+class FileWatcher {
+public:
+    explicit FileWatcher(std::filesystem::path dir);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    void addFile(const std::filesystem::path& filename);
+
+    // Returns paths of watched files changed since the last call.
+    // Doesn't block.
+    std::vector<std::filesystem::path> pollChanges();
+
+private:
+    std::filesystem::path dir;
+    // filename -> last write time (only used for polling)
+    std::unordered_map<std::string, std::filesystem::file_time_type> files;
+
+#ifdef __linux__
+    int inotifyFd{-1};
+    int watchDescriptor{-1};
+#endif
+};
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define UTIL_FLOAT4_WASM
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define UTIL_FLOAT4_SSE
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define UTIL_FLOAT4_NEON
+#endif
+
+namespace util
+{
+// Four floats processed with one instruction: SSE2, NEON or wasm SIMD (web builds
+// with -msimd128). Other targets get a plain loop. Unlike auto-vectorized loops,
+// this doesn't depend on optimization flags (web shipping builds use -Oz, where
+// the loop vectorizer is disabled).
+struct Float4 {
+#if defined(UTIL_FLOAT4_WASM)
+    using Native = v128_t;
+#elif defined(UTIL_FLOAT4_SSE)
+    using Native = __m128;
+#elif defined(UTIL_FLOAT4_NEON)
+    using Native = float32x4_t;
+#else
+    struct Native {
+        float v[4];
+    };
+#endif
+
+    Native v;
+
+    static Float4 load(const float* p);
+    static Float4 broadcast(float x);
+    // (x, x + 1, x + 2, x + 3)
+    static Float4 sequence(float x);
+    void store(float* p) const;
+};
+
+// result of comparisons, each lane is either all ones or zero
+struct Mask4 {
+#if defined(UTIL_FLOAT4_WASM)
+    v128_t v;
+#elif defined(UTIL_FLOAT4_SSE)
+    __m128 v;
+#elif defined(UTIL_FLOAT4_NEON)
+    uint32x4_t v;
+#else
+    std::uint32_t v[4];
+#endif
+
+    // bit i is set if lane i is set
+    std::uint32_t getBits() const;
+};
+
+#if defined(UTIL_FLOAT4_WASM)
+inline Float4 Float4::load(const float* p)
+{
+    return {wasm_v128_load(p)};
+}
+
+inline Float4 Float4::broadcast(float x)
+{
+    return {wasm_f32x4_splat(x)};
+}
+
+inline Float4 Float4::sequence(float x)
+{
+    return {wasm_f32x4_add(wasm_f32x4_splat(x), wasm_f32x4_make(0.f, 1.f, 2.f, 3.f))};
+}
+
+inline void Float4::store(float* p) const
+{
+    wasm_v128_store(p, v);
+}
+
+inline Float4 operator+(Float4 a, Float4 b)
+{
+    return {wasm_f32x4_add(a.v, b.v)};
+}
+
+inline Float4 operator-(Float4 a, Float4 b)
+{
+    return {wasm_f32x4_sub(a.v, b.v)};
+}
+
+inline Float4 operator*(Float4 a, Float4 b)
+{
+    return {wasm_f32x4_mul(a.v, b.v)};
+}
+
+inline Float4 operator/(Float4 a, Float4 b)
+{
+    return {wasm_f32x4_div(a.v, b.v)};
+}
+
+// like std::min/std::max: a is returned if either is NaN
+inline Float4 min(Float4 a, Float4 b)
+{
+    return {wasm_f32x4_pmin(a.v, b.v)};
+}
+
+inline Float4 max(Float4 a, Float4 b)
+{
+    return {wasm_f32x4_pmax(a.v, b.v)};
+}
+
+inline Mask4 operator>=(Float4 a, Float4 b)
+{
+    return {wasm_f32x4_ge(a.v, b.v)};
+}
+
+inline Mask4 operator<=(Float4 a, Float4 b)
+{
+    return {wasm_f32x4_le(a.v, b.v)};
+}
+
+inline Mask4 operator&(Mask4 a, Mask4 b)
+{
+    return {wasm_v128_and(a.v, b.v)};
+}
+
+// mask ? a : b per lane
+inline Float4 select(Mask4 mask, Float4 a, Float4 b)
+{
+    return {wasm_v128_bitselect(a.v, b.v, mask.v)};
+}
+
+inline std::uint32_t Mask4::getBits() const
+{
+    return wasm_i32x4_bitmask(v);
+}
+#elif defined(UTIL_FLOAT4_SSE)
+inline Float4 Float4::load(const float* p)
+{
+    return {_mm_loadu_ps(p)};
+}
+
+inline Float4 Float4::broadcast(float x)
+{
+    return {_mm_set1_ps(x)};
+}
+
+inline Float4 Float4::sequence(float x)
+{
+    return {_mm_add_ps(_mm_set1_ps(x), _mm_setr_ps(0.f, 1.f, 2.f, 3.f))};
+}
+
+inline void Float4::store(float* p) const
+{
+    _mm_storeu_ps(p, v);
+}
+
+inline Float4 operator+(Float4 a, Float4 b)
+{
+    return {_mm_add_ps(a.v, b.v)};
+}
+
+inline Float4 operator-(Float4 a, Float4 b)
+{
+    return {_mm_sub_ps(a.v, b.v)};
+}
+
+inline Float4 operator*(Float4 a, Float4 b)
+{
+    return {_mm_mul_ps(a.v, b.v)};
+}
+
+inline Float4 operator/(Float4 a, Float4 b)
+{
+    return {_mm_div_ps(a.v, b.v)};
+}
+
+// minps/maxps return the second operand if either is NaN, swapped to match std::min/std::max
+inline Float4 min(Float4 a, Float4 b)
+{
+    return {_mm_min_ps(b.v, a.v)};
+}
+
+inline Float4 max(Float4 a, Float4 b)
+{
+    return {_mm_max_ps(b.v, a.v)};
+}
+
+inline Mask4 operator>=(Float4 a, Float4 b)
+{
+    return {_mm_cmpge_ps(a.v, b.v)};
+}
+
+inline Mask4 operator<=(Float4 a, Float4 b)
+{
+    return {_mm_cmple_ps(a.v, b.v)};
+}
+
+inline Mask4 operator&(Mask4 a, Mask4 b)
+{
+    return {_mm_and_ps(a.v, b.v)};
+}
+
+inline Float4 select(Mask4 mask, Float4 a, Float4 b)
+{
+    return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+}
+
+inline std::uint32_t Mask4::getBits() const
+{
+    return static_cast<std::uint32_t>(_mm_movemask_ps(v));
+}
+#elif defined(UTIL_FLOAT4_NEON)
+inline Float4 Float4::load(const float* p)
+{
+    return {vld1q_f32(p)};
+}
+
+inline Float4 Float4::broadcast(float x)
+{
+    return {vdupq_n_f32(x)};
+}
+
+inline Float4 Float4::sequence(float x)
+{
+    static const float offsets[4] = {0.f, 1.f, 2.f, 3.f};
+    return {vaddq_f32(vdupq_n_f32(x), vld1q_f32(offsets))};
+}
+
+inline void Float4::store(float* p) const
+{
+    vst1q_f32(p, v);
+}
+
+inline Float4 operator+(Float4 a, Float4 b)
+{
+    return {vaddq_f32(a.v, b.v)};
+}
+
+inline Float4 operator-(Float4 a, Float4 b)
+{
+    return {vsubq_f32(a.v, b.v)};
+}
+
+inline Float4 operator*(Float4 a, Float4 b)
+{
+    return {vmulq_f32(a.v, b.v)};
+}
+
+inline Float4 operator/(Float4 a, Float4 b)
+{
+    return {vdivq_f32(a.v, b.v)};
+}
+
+// not vminq/vmaxq, which return NaN: a is returned if either is NaN, like std::min/std::max
+inline Float4 min(Float4 a, Float4 b)
+{
+    return {vbslq_f32(vcltq_f32(b.v, a.v), b.v, a.v)};
+}
+
+inline Float4 max(Float4 a, Float4 b)
+{
+    return {vbslq_f32(vcltq_f32(a.v, b.v), b.v, a.v)};
+}
+
+inline Mask4 operator>=(Float4 a, Float4 b)
+{
+    return {vcgeq_f32(a.v, b.v)};
+}
+
+inline Mask4 operator<=(Float4 a, Float4 b)
+{
+    return {vcleq_f32(a.v, b.v)};
+}
+
+inline Mask4 operator&(Mask4 a, Mask4 b)
+{
+    return {vandq_u32(a.v, b.v)};
+}
+
+inline Float4 select(Mask4 mask, Float4 a, Float4 b)
+{
+    return {vbslq_f32(mask.v, a.v, b.v)};
+}
+
+inline std::uint32_t Mask4::getBits() const
+{
+    static const std::int32_t shifts[4] = {0, 1, 2, 3};
+    return vaddvq_u32(vshlq_u32(vshrq_n_u32(v, 31), vld1q_s32(shifts)));
+}
+#else
+inline Float4 Float4::load(const float* p)
+{
+    return {{{p[0], p[1], p[2], p[3]}}};
+}
+
+inline Float4 Float4::broadcast(float x)
+{
+    return {{{x, x, x, x}}};
+}
+
+inline Float4 Float4::sequence(float x)
+{
+    return {{{x, x + 1.f, x + 2.f, x + 3.f}}};
+}
+
+inline void Float4::store(float* p) const
+{
+    for (int i = 0; i < 4; ++i) {
+        p[i] = v.v[i];
+    }
+}
+
+namespace detail
+{
+template<typename F>
+Float4 map(Float4 a, Float4 b, F&& f)
+{
+    Float4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v.v[i] = f(a.v.v[i], b.v.v[i]);
+    }
+    return r;
+}
+
+template<typename F>
+Mask4 compare(Float4 a, Float4 b, F&& f)
+{
+    Mask4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = f(a.v.v[i], b.v.v[i]) ? ~0u : 0u;
+    }
+    return r;
+}
+}
+
+inline Float4 operator+(Float4 a, Float4 b)
+{
+    return detail::map(a, b, [](float x, float y) { return x + y; });
+}
+
+inline Float4 operator-(Float4 a, Float4 b)
+{
+    return detail::map(a, b, [](float x, float y) { return x - y; });
+}
+
+inline Float4 operator*(Float4 a, Float4 b)
+{
+    return detail::map(a, b, [](float x, float y) { return x * y; });
+}
+
+inline Float4 operator/(Float4 a, Float4 b)
+{
+    return detail::map(a, b, [](float x, float y) { return x / y; });
+}
+
+inline Float4 min(Float4 a, Float4 b)
+{
+    return detail::map(a, b, [](float x, float y) { return y < x ? y : x; });
+}
+
+inline Float4 max(Float4 a, Float4 b)
+{
+    return detail::map(a, b, [](float x, float y) { return x < y ? y : x; });
+}
+
+inline Mask4 operator>=(Float4 a, Float4 b)
+{
+    return detail::compare(a, b, [](float x, float y) { return x >= y; });
+}
+
+inline Mask4 operator<=(Float4 a, Float4 b)
+{
+    return detail::compare(a, b, [](float x, float y) { return x <= y; });
+}
+
+inline Mask4 operator&(Mask4 a, Mask4 b)
+{
+    Mask4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = a.v[i] & b.v[i];
+    }
+    return r;
+}
+
+inline Float4 select(Mask4 mask, Float4 a, Float4 b)
+{
+    Float4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v.v[i] = mask.v[i] ? a.v.v[i] : b.v.v[i];
+    }
+    return r;
+}
+
+inline std::uint32_t Mask4::getBits() const
+{
+    std::uint32_t bits = 0;
+    for (int i = 0; i < 4; ++i) {
+        bits |= (v[i] & 1u) << i;
+    }
+    return bits;
+}
+#endif
+}
@@ -1,32 +1,69 @@
 #include "GLUtil.h"
 
-#include <cassert>
-#include <iostream>
-#include <regex>
-#include <sstream>
+#include <charconv>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <Platform/gl.h>
+#include <util/Log.h>
 
 namespace
 {
-std::pair<int, int> getErrorStringNumber(const std::string& errorLog)
+const char* parseNumber(const char* p, const char* end, int& n)
 {
-    static const auto r = std::regex("\\d:(\\d+)\\((\\d+\\)).*");
-    std::smatch match;
-    if (std::regex_search(errorLog, match, r)) {
-        assert(match.size() == 3);
-        int lineNum{};
-        std::istringstream(match[1].str()) >> lineNum;
-        int charNum{};
-        std::istringstream(match[2].str()) >> charNum;
-        return {lineNum, charNum};
+    const auto [ptr, ec] = std::from_chars(p, end, n);
+    return ec == std::errc{} ? ptr : nullptr;
+}
+
+// Finds the source location in a line of a shader info log.
+// Mesa: "0:12(5): error: ...", most other drivers: "ERROR: 0:12: ..." (no column).
+// Returns {-1, -1} if there's none, the column is -1 if it's unknown.
+std::pair<int, int> getErrorLocation(std::string_view line)
+{
+    const char* end = line.data() + line.size();
+    for (auto pos = line.find(':'); pos != std::string_view::npos; pos = line.find(':', pos + 1)) {
+        // <source string number>:<line>
+        if (pos == 0 || line[pos - 1] < '0' || line[pos - 1] > '9') {
+            continue;
+        }
+        int lineNum;
+        const char* p = parseNumber(line.data() + pos + 1, end, lineNum);
+        if (!p || p == end) {
+            continue;
+        }
+        if (*p == ':') {
+            return {lineNum, -1};
+        }
+        int charNum;
+        if (*p == '(' && (p = parseNumber(p + 1, end, charNum)) && p != end && *p == ')') {
+            return {lineNum, charNum};
+        }
     }
     return {-1, -1};
 }
+
+std::vector<std::string_view> splitLines(std::string_view s)
+{
+    std::vector<std::string_view> lines;
+    while (!s.empty()) {
+        const auto pos = s.find('\n');
+        lines.push_back(s.substr(0, pos));
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        s.remove_prefix(pos + 1);
+    }
+    return lines;
+}
+
+void logLine(std::string_view line)
+{
+    LOG_ERROR("%s", std::string(line).c_str());
 }
 
+} // end of anonymous namespace
+
 namespace util
 {
 bool printShaderCompilationErrors(std::uint32_t shaderObject, const std::string& shaderSource)
@@ -37,37 +74,29 @@ bool printShaderCompilationErrors(std::uint32_t shaderObject, const std::string&
         return true;
     }
 
-    std::cerr << "Failed to compile shader: ";
-
     GLint logLength;
     glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &logLength);
     std::string log(logLength + 1, '\0');
     glGetShaderInfoLog(shaderObject, logLength, NULL, &log[0]);
+    log.resize(std::char_traits<char>::length(log.c_str()));
 
-    std::vector<std::string> lines;
-    {
-        std::stringstream ss(shaderSource);
-        std::string line;
-        while (std::getline(ss, line, '\n')) {
-            lines.push_back(line);
+    // Info logs can be longer than a log record, so every line is logged separately.
+    // The offending source line is shown under the first error.
+    LOG_ERROR("Failed to compile shader:");
+    const auto sourceLines = splitLines(shaderSource);
+    bool isSourceShown = false;
+    for (const auto line : splitLines(log)) {
+        logLine(line);
+        const auto [errorLineNum, charNum] = getErrorLocation(line);
+        if (isSourceShown || errorLineNum < 1 ||
+            errorLineNum > static_cast<int>(sourceLines.size())) {
+            continue;
         }
-    }
-    int lineNum = 1;
-    std::stringstream ss(log);
-    std::string line;
-    while (std::getline(ss, line, '\n')) {
-        auto [errorLineNum, charNum] = getErrorStringNumber(line);
-        if (errorLineNum != -1) {
-            std::cerr << line << std::endl;
-            std::cerr << "> " << lines[errorLineNum - 1] << std::endl;
-            for (int i = 0; i < charNum + 4; ++i) {
-                std::cerr << " ";
-            }
-            std::cerr << "^~\n";
-            break;
-        } else {
-            std::cerr << line << std::endl;
+        logLine(std::string("> ").append(sourceLines[errorLineNum - 1]));
+        if (charNum >= 0) {
+            logLine(std::string(charNum + 4, ' ').append("^~"));
         }
+        isSourceShown = true;
     }
     return false;
 }
@@ -80,15 +109,16 @@ bool printShaderLinkErrors(std::uint32_t shaderProgram)
         return true;
     }
 
-    std::string msg("Program linking failure: ");
-    std::cerr << "Failed to link program: ";
-
     GLint logLength;
-    glGetShaderiv(shaderProgram, GL_INFO_LOG_LENGTH, &logLength);
-    std::cout << logLength << std::endl;
+    glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &logLength);
     std::string log(logLength + 1, '\0');
     glGetProgramInfoLog(shaderProgram, logLength, NULL, &log[0]);
-    std::cerr << log << std::endl;
+    log.resize(std::char_traits<char>::length(log.c_str()));
+
+    LOG_ERROR("Failed to link program:");
+    for (const auto line : splitLines(log)) {
+        logLine(line);
+    }
     return false;
 }
 
@@ -1,9 +1,20 @@
 #include "GltfLoader.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <span>
+#include <unordered_map>
 
-#include <Graphics/Model.h>
+#include <Graphics/ModelData.h>
+#include <Graphics/ShaderUniforms.h>
+#include <util/Log.h>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/matrix.hpp>
 
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_NO_STB_IMAGE
@@ -46,11 +57,21 @@ static const std::string GLTF_POSITIONS_ACCESSOR{"POSITION"};
 static const std::string GLTF_NORMALS_ACCESSOR{"NORMAL"};
 static const std::string GLTF_TANGENTS_ACCESSOR{"TANGENT"};
 static const std::string GLTF_UVS_ACCESSOR{"TEXCOORD_0"};
+static const std::string GLTF_JOINTS_ACCESSOR{"JOINTS_0"};
+static const std::string GLTF_WEIGHTS_ACCESSOR{"WEIGHTS_0"};
 
 static const std::string GLTF_SAMPLER_PATH_TRANSLATION{"translation"};
 static const std::string GLTF_SAMPLER_PATH_ROTATION{"rotation"};
 static const std::string GLTF_SAMPLER_PATH_SCALE{"scale"};
 
+static const std::string GLTF_INTERPOLATION_STEP{"STEP"};
+static const std::string GLTF_INTERPOLATION_CUBICSPLINE{"CUBICSPLINE"};
+
+bool isGLB(std::span<const std::uint8_t> data)
+{
+    return data.size() >= 4 && std::memcmp(data.data(), "glTF", 4) == 0;
+}
+
 glm::vec3 tg2glm(const std::vector<double>& vec)
 {
     return {vec[0], vec[1], vec[2]};
@@ -66,6 +87,49 @@ glm::quat tg2glmQuat(const std::vector<double>& vec)
     };
 }
 
+// local transform of a node, given either as TRS or as a matrix
+glm::mat4 getNodeTransform(const tinygltf::Node& node)
+{
+    glm::mat4 m{1.f};
+    if (!node.matrix.empty()) {
+        for (int i = 0; i < 16; ++i) {
+            m[i / 4][i % 4] = static_cast<float>(node.matrix[i]); // column-major
+        }
+        return m;
+    }
+    if (!node.translation.empty()) {
+        m = glm::translate(m, tg2glm(node.translation));
+    }
+    if (!node.rotation.empty()) {
+        m = m * glm::mat4_cast(tg2glmQuat(node.rotation));
+    }
+    if (!node.scale.empty()) {
+        m = glm::scale(m, tg2glm(node.scale));
+    }
+    return m;
+}
+
+// splits a transform without shear (as glTF requires for nodes) into T * R * S
+void decomposeTransform(const glm::mat4& m, glm::vec3& t, glm::quat& r, glm::vec3& s)
+{
+    t = glm::vec3{m[3]};
+    s = glm::vec3{
+        glm::length(glm::vec3{m[0]}),
+        glm::length(glm::vec3{m[1]}),
+        glm::length(glm::vec3{m[2]}),
+    };
+    // a mirrored basis can't be a rotation, so it's stored as a negative scale
+    if (glm::determinant(glm::mat3{m}) < 0.f) {
+        s.x = -s.x;
+    }
+    const glm::mat3 rotation{
+        glm::vec3{m[0]} / s.x,
+        glm::vec3{m[1]} / s.y,
+        glm::vec3{m[2]} / s.z,
+    };
+    r = glm::normalize(glm::quat_cast(rotation));
+}
+
 template<typename T>
 std::span<const T> getPackedBufferSpan(
     const tinygltf::Model& model,
@@ -118,12 +182,83 @@ std::filesystem::path getDiffuseTexturePath(
     return image.uri;
 }
 
-Mesh loadMesh(
+using UByte4 = std::array<std::uint8_t, 4>;
+using UShort4 = std::array<std::uint16_t, 4>;
+
+template<typename T>
+std::array<std::uint8_t, 4> remapJoints(const T& joints, const std::vector<int>& jointRemap)
+{
+    std::array<std::uint8_t, 4> res;
+    for (int i = 0; i < 4; ++i) {
+        const auto newIndex = jointRemap[joints[i]];
+        assert(newIndex < 256 && "too many joints");
+        res[i] = static_cast<std::uint8_t>(newIndex);
+    }
+    return res;
+}
+
+void loadSkinVertices(
+    const tinygltf::Model& model,
+    const tinygltf::Primitive& primitive,
+    const std::vector<int>& jointRemap,
+    MeshData& mesh)
+{
+    mesh.skinVertices.resize(mesh.vertices.size());
+
+    // joints
+    const auto& jointsAccessor =
+        model.accessors[findAttributeAccessor(primitive, GLTF_JOINTS_ACCESSOR)];
+    assert(jointsAccessor.count == mesh.vertices.size());
+    if (jointsAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+        const auto joints = getPackedBufferSpan<UByte4>(model, jointsAccessor);
+        for (std::size_t i = 0; i < joints.size(); ++i) {
+            mesh.skinVertices[i].joints = remapJoints(joints[i], jointRemap);
+        }
+    } else {
+        assert(jointsAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+        const auto joints = getPackedBufferSpan<UShort4>(model, jointsAccessor);
+        for (std::size_t i = 0; i < joints.size(); ++i) {
+            mesh.skinVertices[i].joints = remapJoints(joints[i], jointRemap);
+        }
+    }
+
+    // weights (can be normalized integers)
+    const auto& weightsAccessor =
+        model.accessors[findAttributeAccessor(primitive, GLTF_WEIGHTS_ACCESSOR)];
+    assert(weightsAccessor.count == mesh.vertices.size());
+    switch (weightsAccessor.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+        const auto weights = getPackedBufferSpan<glm::vec4>(model, weightsAccessor);
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            mesh.skinVertices[i].weights = weights[i];
+        }
+    } break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+        const auto weights = getPackedBufferSpan<UByte4>(model, weightsAccessor);
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            const auto& w = weights[i];
+            mesh.skinVertices[i].weights = glm::vec4{w[0], w[1], w[2], w[3]} / 255.f;
+        }
+    } break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+        const auto weights = getPackedBufferSpan<UShort4>(model, weightsAccessor);
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            const auto& w = weights[i];
+            mesh.skinVertices[i].weights = glm::vec4{w[0], w[1], w[2], w[3]} / 65535.f;
+        }
+    } break;
+    default:
+        assert(false && "unsupported weights component type");
+    }
+}
+
+MeshData loadMesh(
     const tinygltf::Model& model,
     const std::string& meshName,
-    const tinygltf::Primitive& primitive)
+    const tinygltf::Primitive& primitive,
+    const std::vector<int>& jointRemap)
 {
-    Mesh mesh;
+    MeshData mesh;
     mesh.name = meshName;
 
     if (primitive.material != -1) {
@@ -147,8 +282,14 @@ Mesh loadMesh(
     const auto positions =
         getPackedBufferSpan<glm::vec3>(model, primitive, GLTF_POSITIONS_ACCESSOR);
     assert(positions.size() == mesh.vertices.size());
+    if (!positions.empty()) {
+        mesh.boundsMin = positions[0];
+        mesh.boundsMax = positions[0];
+    }
     for (std::size_t i = 0; i < positions.size(); ++i) {
         mesh.vertices[i].pos = positions[i];
+        mesh.boundsMin = glm::min(mesh.boundsMin, positions[i]);
+        mesh.boundsMax = glm::max(mesh.boundsMax, positions[i]);
     }
 
     // load normals
@@ -180,17 +321,252 @@ Mesh loadMesh(
         }
     }
 
+    // load skinning data
+    if (!jointRemap.empty() && hasAccessor(primitive, GLTF_JOINTS_ACCESSOR) &&
+        hasAccessor(primitive, GLTF_WEIGHTS_ACCESSOR)) {
+        loadSkinVertices(model, primitive, jointRemap, mesh);
+    }
+
     return mesh;
 }
 
+int findMeshNode(const tinygltf::Model& model)
+{
+    const auto& scene = model.scenes[model.defaultScene];
+    const auto& rootNode = scene.nodes[0];
+    if (model.nodes[rootNode].mesh != -1) {
+        return rootNode;
+    }
+    // skinned meshes are usually not in the root (which is an armature)
+    for (std::size_t i = 0; i < model.nodes.size(); ++i) {
+        if (model.nodes[i].mesh != -1) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Fills jointRemap with a mapping from glTF skin joint index to Skeleton joint index,
+// returns false if the skin can't be used for skinning
+bool loadSkeleton(
+    const tinygltf::Model& model,
+    const tinygltf::Skin& skin,
+    Skeleton& skeleton,
+    std::vector<int>& jointRemap)
+{
+    const auto numJoints = skin.joints.size();
+    if (numJoints > MAX_JOINTS) {
+        LOG_ERROR(
+            "Skin '%s' has %zu joints, at most %zu are supported",
+            skin.name.c_str(),
+            numJoints,
+            MAX_JOINTS);
+        return false;
+    }
+
+    std::unordered_map<int, int> nodeToSkinJoint;
+    for (std::size_t i = 0; i < numJoints; ++i) {
+        nodeToSkinJoint[skin.joints[i]] = static_cast<int>(i);
+    }
+
+    // find parents
+    std::vector<int> skinParents(numJoints, -1);
+    for (std::size_t i = 0; i < numJoints; ++i) {
+        for (const auto child : model.nodes[skin.joints[i]].children) {
+            if (const auto it = nodeToSkinJoint.find(child); it != nodeToSkinJoint.end()) {
+                skinParents[it->second] = static_cast<int>(i);
+            }
+        }
+    }
+
+    // sort joints by depth so that parents always come before their children
+    std::vector<int> depths(numJoints, 0);
+    for (std::size_t i = 0; i < numJoints; ++i) {
+        for (int p = skinParents[i]; p != -1; p = skinParents[p]) {
+            ++depths[i];
+        }
+    }
+    std::vector<int> order(numJoints);
+    for (std::size_t i = 0; i < numJoints; ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&depths](int a, int b) {
+        return depths[a] < depths[b];
+    });
+    jointRemap.resize(numJoints);
+    for (std::size_t i = 0; i < numJoints; ++i) {
+        jointRemap[order[i]] = static_cast<int>(i);
+    }
+
+    skeleton.parents.resize(numJoints);
+    skeleton.jointNames.resize(numJoints);
+    skeleton.restPose.resize(numJoints);
+    skeleton.inverseBindMatrices.resize(numJoints);
+
+    std::span<const glm::mat4> inverseBindMatrices;
+    if (skin.inverseBindMatrices != -1) {
+        inverseBindMatrices =
+            getPackedBufferSpan<glm::mat4>(model, model.accessors[skin.inverseBindMatrices]);
+        assert(inverseBindMatrices.size() == numJoints);
+    }
+
+    for (std::size_t i = 0; i < numJoints; ++i) {
+        const auto j = jointRemap[i];
+        const auto& node = model.nodes[skin.joints[i]];
+
+        skeleton.parents[j] =
+            static_cast<std::int16_t>(skinParents[i] == -1 ? -1 : jointRemap[skinParents[i]]);
+        skeleton.jointNames[j] = node.name;
+
+        // animated joints always use TRS, but the rest pose can be given as a matrix
+        glm::vec3 t{0.f};
+        glm::quat r{1.f, 0.f, 0.f, 0.f};
+        glm::vec3 s{1.f};
+        if (!node.matrix.empty()) {
+            decomposeTransform(getNodeTransform(node), t, r, s);
+        } else {
+            if (!node.translation.empty()) {
+                t = tg2glm(node.translation);
+            }
+            if (!node.rotation.empty()) {
+                r = tg2glmQuat(node.rotation);
+            }
+            if (!node.scale.empty()) {
+                s = tg2glm(node.scale);
+            }
+        }
+
+        auto& pose = skeleton.restPose;
+        pose.tx[j] = t.x;
+        pose.ty[j] = t.y;
+        pose.tz[j] = t.z;
+        pose.rx[j] = r.x;
+        pose.ry[j] = r.y;
+        pose.rz[j] = r.z;
+        pose.rw[j] = r.w;
+        pose.sx[j] = s.x;
+        pose.sy[j] = s.y;
+        pose.sz[j] = s.z;
+
+        // affine 3x4 rows from column-major mat4
+        auto& ibm = skeleton.inverseBindMatrices.m;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                ibm[r * 4 + c][j] = inverseBindMatrices.empty() ?
+                                        (r == c ? 1.f : 0.f) :
+                                        inverseBindMatrices[i][c][r];
+            }
+        }
+    }
+
+    // nodes above the root joints (e.g. an armature with a rotation or a scale)
+    // are not joints, but they still move the skeleton
+    std::vector<int> nodeParents(model.nodes.size(), -1);
+    for (std::size_t i = 0; i < model.nodes.size(); ++i) {
+        for (const auto child : model.nodes[i].children) {
+            nodeParents[child] = static_cast<int>(i);
+        }
+    }
+    bool hasRootTransform = false;
+    for (std::size_t i = 0; i < numJoints; ++i) {
+        if (skinParents[i] != -1) {
+            continue;
+        }
+        glm::mat4 rootTransform{1.f};
+        for (int p = nodeParents[skin.joints[i]]; p != -1; p = nodeParents[p]) {
+            rootTransform = getNodeTransform(model.nodes[p]) * rootTransform;
+        }
+        if (!hasRootTransform) {
+            skeleton.rootTransform = rootTransform;
+            hasRootTransform = true;
+        } else if (rootTransform != skeleton.rootTransform) {
+            LOG_WARN(
+                "Skin '%s': root joints have different parent transforms, using the first one",
+                skin.name.c_str());
+        }
+    }
+
+    return true;
+}
+
+AnimationClip loadAnimation(
+    const tinygltf::Model& model,
+    const tinygltf::Animation& animation,
+    const std::unordered_map<int, int>& nodeToJoint)
+{
+    AnimationClip clip;
+    clip.name = animation.name;
+
+    for (const auto& channel : animation.channels) {
+        const auto it = nodeToJoint.find(channel.target_node);
+        if (it == nodeToJoint.end()) {
+            continue; // not a joint of the skeleton
+        }
+
+        AnimationTrack track;
+        track.joint = static_cast<std::uint16_t>(it->second);
+        std::size_t numComponents = 3;
+        if (channel.target_path == GLTF_SAMPLER_PATH_TRANSLATION) {
+            track.path = AnimationTrack::Path::Translation;
+        } else if (channel.target_path == GLTF_SAMPLER_PATH_ROTATION) {
+            track.path = AnimationTrack::Path::Rotation;
+            numComponents = 4;
+        } else if (channel.target_path == GLTF_SAMPLER_PATH_SCALE) {
+            track.path = AnimationTrack::Path::Scale;
+        } else {
+            continue; // morph target weights are not supported
+        }
+
+        const auto& sampler = animation.samplers[channel.sampler];
+        track.step = (sampler.interpolation == GLTF_INTERPOLATION_STEP);
+
+        const auto& inputAccessor = model.accessors[sampler.input];
+        const auto& outputAccessor = model.accessors[sampler.output];
+        assert(outputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+
+        const auto times = getPackedBufferSpan<float>(model, inputAccessor);
+        track.times.assign(times.begin(), times.end());
+
+        // cubic spline keys are stored as (in-tangent, value, out-tangent) -
+        // only values are used and interpolated linearly
+        const bool cubic = (sampler.interpolation == GLTF_INTERPOLATION_CUBICSPLINE);
+        const std::size_t stride = cubic ? 3 : 1;
+        const std::size_t offset = cubic ? 1 : 0;
+
+        track.values.resize(times.size() * numComponents);
+        if (numComponents == 4) {
+            const auto values = getPackedBufferSpan<glm::vec4>(model, outputAccessor);
+            for (std::size_t k = 0; k < times.size(); ++k) {
+                for (int c = 0; c < 4; ++c) {
+                    track.values[k * 4 + c] = values[k * stride + offset][c];
+                }
+            }
+        } else {
+            const auto values = getPackedBufferSpan<glm::vec3>(model, outputAccessor);
+            for (std::size_t k = 0; k < times.size(); ++k) {
+                for (int c = 0; c < 3; ++c) {
+                    track.values[k * 3 + c] = values[k * stride + offset][c];
+                }
+            }
+        }
+
+        if (!track.times.empty()) {
+            clip.duration = std::max(clip.duration, track.times.back());
+        }
+        clip.tracks.push_back(std::move(track));
+    }
+
+    return clip;
+}
+
 }
 
 namespace util
 {
 
-Model loadModel(const std::filesystem::path& path)
+ModelData loadGltfModel(const std::filesystem::path& path, std::span<const std::uint8_t> data)
 {
-    Model model;
+    ModelData model;
 
     tinygltf::TinyGLTF loader;
     loader.SetImageLoader(::LoadImageData, nullptr);
@@ -200,21 +576,33 @@ Model loadModel(const std::filesystem::path& path)
     std::string err;
     std::string warn;
 
-    bool res = loader.LoadASCIIFromFile(&gltfModel, &err, &warn, path.string());
+    // external buffers of loose .gltf files are loaded relative to this dir
+    const auto baseDir = path.parent_path().string();
+    bool res = false;
+    if (isGLB(data)) {
+        res = loader.LoadBinaryFromMemory(
+            &gltfModel, &err, &warn, data.data(), static_cast<unsigned int>(data.size()), baseDir);
+    } else {
+        res = loader.LoadASCIIFromString(
+            &gltfModel,
+            &err,
+            &warn,
+            reinterpret_cast<const char*>(data.data()),
+            static_cast<unsigned int>(data.size()),
+            baseDir);
+    }
     if (!warn.empty()) {
-        printf("WARN: %s\n", warn.c_str());
+        LOG_WARN("%s: %s", path.string().c_str(), warn.c_str());
     }
     if (!res) {
-        printf("Failed to load glTF scene: %s\n", path.c_str());
-        if (!err.empty()) {
-            printf("ERR: %s\n", err.c_str());
-        }
+        LOG_ERROR("Failed to load glTF scene '%s': %s", path.string().c_str(), err.c_str());
         assert(false);
     }
 
-    auto& scene = gltfModel.scenes[gltfModel.defaultScene];
-    auto& gltfNode = gltfModel.nodes[scene.nodes[0]];
-    auto& mesh = gltfModel.meshes[gltfNode.mesh];
+    const auto meshNodeIndex = findMeshNode(gltfModel);
+    assert(meshNodeIndex != -1 && "no meshes in the scene");
+    auto& gltfNode = gltfModel.nodes[meshNodeIndex];
+    auto& gltfMesh = gltfModel.meshes[gltfNode.mesh];
     if (!gltfNode.translation.empty()) {
         model.position = tg2glm(gltfNode.translation);
     }
@@ -225,9 +613,25 @@ Model loadModel(const std::filesystem::path& path)
         model.rotation = tg2glmQuat(gltfNode.rotation);
     }
 
-    for (const auto& p : mesh.primitives) {
-        Mesh mesh = loadMesh(gltfModel, mesh.name, p);
-        model.meshes.push_back(std::move(mesh));
+    std::vector<int> jointRemap;
+    if (gltfNode.skin != -1) {
+        const auto& skin = gltfModel.skins[gltfNode.skin];
+        if (!loadSkeleton(gltfModel, skin, model.skeleton, jointRemap)) {
+            LOG_ERROR("Failed to load skeleton of '%s'", path.string().c_str());
+            return {};
+        }
+
+        std::unordered_map<int, int> nodeToJoint;
+        for (std::size_t i = 0; i < skin.joints.size(); ++i) {
+            nodeToJoint[skin.joints[i]] = jointRemap[i];
+        }
+        for (const auto& animation : gltfModel.animations) {
+            model.animations.push_back(loadAnimation(gltfModel, animation, nodeToJoint));
+        }
+    }
+
+    for (const auto& p : gltfMesh.primitives) {
+        model.meshes.push_back(loadMesh(gltfModel, gltfMesh.name, p, jointRemap));
     }
 
     return model;
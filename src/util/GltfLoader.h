@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <span>
 
-struct Model;
+struct ModelData;
 
 namespace util
 {
-Model loadModel(const std::filesystem::path& path);
+// Parses .gltf (external buffers are loaded relative to path) or .glb data.
+// Not available in shipping builds, use util::loadModel instead.
+ModelData loadGltfModel(const std::filesystem::path& path, std::span<const std::uint8_t> data);
 }
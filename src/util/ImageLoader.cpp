@@ -1,5 +1,17 @@
 #include "ImageLoader.h"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+#include <util/Log.h>
+#include <util/TaskScheduler.h>
+#include <util/VirtualFS.h>
+
+// stb_image's global flip flag is never set, images are flipped by flipImageVertically
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -9,21 +21,265 @@ ImageData::~ImageData()
     stbi_image_free(hdrPixels);
 }
 
+ImageData::ImageData(ImageData&& o) noexcept :
+    pixels(std::exchange(o.pixels, nullptr)),
+    width(o.width),
+    height(o.height),
+    channels(o.channels),
+    hdrPixels(std::exchange(o.hdrPixels, nullptr)),
+    hdr(o.hdr),
+    comp(o.comp)
+{}
+
+ImageData& ImageData::operator=(ImageData&& o) noexcept
+{
+    std::swap(pixels, o.pixels);
+    std::swap(hdrPixels, o.hdrPixels);
+    width = o.width;
+    height = o.height;
+    channels = o.channels;
+    hdr = o.hdr;
+    comp = o.comp;
+    return *this;
+}
+
+std::size_t ImageData::getSize() const
+{
+    const auto componentSize = pixels ? sizeof(unsigned char) : hdrPixels ? sizeof(float) : 0;
+    return static_cast<std::size_t>(width) * height * channels * componentSize;
+}
+
+namespace
+{
+// the alpha channel is the last one in gray-alpha and RGBA images
+constexpr bool hasAlpha(int channels)
+{
+    return channels == 2 || channels == 4;
+}
+
+float decodeSRGB(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float encodeSRGB(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+}
+
+const std::array<float, 256>& getSRGBToLinearTable()
+{
+    static const auto table = [] {
+        std::array<float, 256> t;
+        for (std::size_t i = 0; i < t.size(); ++i) {
+            t[i] = decodeSRGB(i / 255.f);
+        }
+        return t;
+    }();
+    return table;
+}
+
+// indexed by linear value * (size - 1), fine enough for 8-bit sRGB output
+constexpr std::size_t LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+
+const std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE>& getLinearToSRGBTable()
+{
+    static const auto table = [] {
+        std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> t;
+        for (std::size_t i = 0; i < t.size(); ++i) {
+            const auto c = encodeSRGB(i / static_cast<float>(t.size() - 1));
+            t[i] = static_cast<std::uint8_t>(std::lround(c * 255.f));
+        }
+        return t;
+    }();
+    return table;
+}
+
+template<int N>
+void premultiplyLinear(std::uint8_t* pixels, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels; ++i) {
+        auto* p = pixels + i * N;
+        const unsigned a = p[N - 1];
+        for (int c = 0; c < N - 1; ++c) {
+            // c * a / 255, rounded
+            const unsigned t = p[c] * a + 128;
+            p[c] = static_cast<std::uint8_t>((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+template<int N>
+void premultiplySRGB(std::uint8_t* pixels, std::size_t numPixels)
+{
+    const auto& toLinear = getSRGBToLinearTable();
+    const auto& toSRGB = getLinearToSRGBTable();
+    constexpr auto scale = (LINEAR_TO_SRGB_TABLE_SIZE - 1) / 255.f;
+    for (std::size_t i = 0; i < numPixels; ++i) {
+        auto* p = pixels + i * N;
+        const auto a = p[N - 1] * scale;
+        for (int c = 0; c < N - 1; ++c) {
+            p[c] = toSRGB[static_cast<std::size_t>(toLinear[p[c]] * a + 0.5f)];
+        }
+    }
+}
+
+template<int N>
+void premultiplyFloat(float* pixels, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels; ++i) {
+        auto* p = pixels + i * N;
+        for (int c = 0; c < N - 1; ++c) {
+            p[c] *= p[N - 1];
+        }
+    }
+}
+
+template<int N>
+void convertSRGBToLinear(const std::uint8_t* src, float* dst, std::size_t numPixels)
+{
+    const auto& toLinear = getSRGBToLinearTable();
+    constexpr int numColors = hasAlpha(N) ? N - 1 : N;
+    for (std::size_t i = 0; i < numPixels; ++i) {
+        const auto* s = src + i * N;
+        auto* d = dst + i * N;
+        for (int c = 0; c < numColors; ++c) {
+            d[c] = toLinear[s[c]];
+        }
+        if constexpr (numColors != N) {
+            d[N - 1] = s[N - 1] * (1.f / 255.f);
+        }
+    }
+}
+
+} // end of anonymous namespace
+
 namespace util
 {
-ImageData loadImage(const std::filesystem::path& p, bool flipOnLoad)
+void flipImageVertically(void* pixels, std::size_t rowSize, int height)
+{
+    auto* bytes = static_cast<std::uint8_t*>(pixels);
+    for (int y = 0; y < height / 2; ++y) {
+        auto* top = bytes + y * rowSize;
+        auto* bottom = bytes + (height - 1 - y) * rowSize;
+        std::swap_ranges(top, top + rowSize, bottom);
+    }
+}
+
+void premultiplyAlpha(std::uint8_t* pixels, std::size_t numPixels, int channels, bool isSRGB)
+{
+    if (channels == 2) {
+        isSRGB ? premultiplySRGB<2>(pixels, numPixels) : premultiplyLinear<2>(pixels, numPixels);
+    } else if (channels == 4) {
+        isSRGB ? premultiplySRGB<4>(pixels, numPixels) : premultiplyLinear<4>(pixels, numPixels);
+    }
+}
+
+void premultiplyAlpha(float* pixels, std::size_t numPixels, int channels)
+{
+    if (channels == 2) {
+        premultiplyFloat<2>(pixels, numPixels);
+    } else if (channels == 4) {
+        premultiplyFloat<4>(pixels, numPixels);
+    }
+}
+
+void srgbToLinear(const std::uint8_t* src, float* dst, std::size_t numPixels, int channels)
 {
-    stbi_set_flip_vertically_on_load(flipOnLoad);
+    switch (channels) {
+    case 1:
+        convertSRGBToLinear<1>(src, dst, numPixels);
+        break;
+    case 2:
+        convertSRGBToLinear<2>(src, dst, numPixels);
+        break;
+    case 3:
+        convertSRGBToLinear<3>(src, dst, numPixels);
+        break;
+    case 4:
+        convertSRGBToLinear<4>(src, dst, numPixels);
+        break;
+    default:
+        assert(false);
+    }
+}
 
+ImageData decodeImage(std::span<const std::uint8_t> bytes, const ImageLoadParams& params)
+{
+    assert(params.channels >= 0 && params.channels <= 4);
     ImageData data;
-    if (stbi_is_hdr(p.string().c_str())) {
+    const auto size = static_cast<int>(bytes.size());
+    if (stbi_is_hdr_from_memory(bytes.data(), size)) {
         data.hdr = true;
-        data.hdrPixels = stbi_loadf(p.string().c_str(), &data.width, &data.height, &data.comp, 4);
+        data.hdrPixels = stbi_loadf_from_memory(
+            bytes.data(), size, &data.width, &data.height, &data.comp, params.channels);
     } else {
-        data.pixels = stbi_load(p.string().c_str(), &data.width, &data.height, &data.channels, 4);
+        data.pixels = stbi_load_from_memory(
+            bytes.data(), size, &data.width, &data.height, &data.comp, params.channels);
+    }
+    if (!data.pixels && !data.hdrPixels) {
+        return data;
+    }
+    data.channels = params.channels != 0 ? params.channels : data.comp;
+
+    const auto numPixels = static_cast<std::size_t>(data.width) * data.height;
+    if (data.hdr) {
+        if (params.flip) {
+            const auto rowSize = data.width * data.channels * sizeof(float);
+            flipImageVertically(data.hdrPixels, rowSize, data.height);
+        }
+        if (params.premultiplyAlpha) {
+            premultiplyAlpha(data.hdrPixels, numPixels, data.channels);
+        }
+        return data;
+    }
+
+    if (params.flip) {
+        flipImageVertically(data.pixels, data.width * data.channels, data.height);
+    }
+    if (params.srgbToLinear) {
+        // freed with stbi_image_free, which is free by default
+        data.hdrPixels =
+            static_cast<float*>(std::malloc(numPixels * data.channels * sizeof(float)));
+        srgbToLinear(data.pixels, data.hdrPixels, numPixels, data.channels);
+        stbi_image_free(data.pixels);
+        data.pixels = nullptr;
+        if (params.premultiplyAlpha) {
+            premultiplyAlpha(data.hdrPixels, numPixels, data.channels);
+        }
+    } else if (params.premultiplyAlpha) {
+        premultiplyAlpha(data.pixels, numPixels, data.channels, params.isSRGB);
     }
-    data.channels = 4;
     return data;
 }
 
+ImageData loadImage(const std::filesystem::path& p, const ImageLoadParams& params)
+{
+    const auto file = util::readAssetFile(p);
+    if (!file) {
+        return {};
+    }
+    auto data = decodeImage(file.getBytes(), params);
+    if (!data.pixels && !data.hdrPixels) {
+        // the failure reason is thread-local
+        LOG_WARN("Failed to decode '%s': %s", p.string().c_str(), stbi_failure_reason());
+    }
+    return data;
+}
+
+std::vector<ImageData> loadImages(
+    std::span<const std::filesystem::path> paths,
+    const ImageLoadParams& params,
+    TaskScheduler& scheduler)
+{
+    std::vector<ImageData> images(paths.size());
+    // images can differ in size a lot, so each one is a separate task
+    scheduler.parallelFor(paths.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            images[i] = loadImage(paths[i], params);
+        }
+    });
+    return images;
+}
+
 } // namespace util
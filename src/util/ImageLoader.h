@@ -1,32 +1,66 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <span>
+#include <vector>
 
 struct ImageData {
     ImageData() = default;
     ~ImageData();
 
     // move only
-    ImageData(ImageData&& o) = default;
-    ImageData& operator=(ImageData&& o) = default;
+    ImageData(ImageData&& o) noexcept;
+    ImageData& operator=(ImageData&& o) noexcept;
 
     // no copies
     ImageData(const ImageData& o) = delete;
     ImageData& operator=(const ImageData& o) = delete;
 
+    // size of pixels or hdrPixels in bytes
+    std::size_t getSize() const;
+
     // data
     unsigned char* pixels{nullptr};
     int width{0};
     int height{0};
-    int channels{0};
+    int channels{0}; // in pixels/hdrPixels
 
-    // HDR only
+    // HDR images and 8-bit images converted with srgbToLinear
     float* hdrPixels{nullptr};
     bool hdr{false};
-    int comp{0};
+    int comp{0}; // channels in the file
 };
 
 namespace util
 {
-ImageData loadImage(const std::filesystem::path& p, bool flipOnLoad = true);
+class TaskScheduler;
+
+struct ImageLoadParams {
+    bool flip{true}; // the first row is the bottom one, like GL expects
+    int channels{4}; // 1-4, 0 keeps the file's channel count
+    bool premultiplyAlpha{false};
+    // 8-bit images only: color channels are sRGB, so they're premultiplied in linear space
+    bool isSRGB{true};
+    // 8-bit images only: decode into linear floats (hdrPixels), alpha stays linear
+    bool srgbToLinear{false};
+};
+
+// Can be called from any thread (doesn't touch global stb_image settings)
+ImageData loadImage(const std::filesystem::path& p, const ImageLoadParams& params = {});
+ImageData decodeImage(std::span<const std::uint8_t> bytes, const ImageLoadParams& params = {});
+// Loads images on the scheduler's workers, images which failed to load have no pixels
+std::vector<ImageData> loadImages(
+    std::span<const std::filesystem::path> paths,
+    const ImageLoadParams& params,
+    TaskScheduler& scheduler);
+
+// In-place conversions done by decodeImage. sRGB conversions use lookup tables,
+// the other loops are left to the auto-vectorizer (web shipping builds compile
+// ImageLoader.cpp with -O3 for this, see src/CMakeLists.txt).
+void flipImageVertically(void* pixels, std::size_t rowSize, int height);
+void premultiplyAlpha(std::uint8_t* pixels, std::size_t numPixels, int channels, bool isSRGB);
+void premultiplyAlpha(float* pixels, std::size_t numPixels, int channels);
+void srgbToLinear(const std::uint8_t* src, float* dst, std::size_t numPixels, int channels);
 }
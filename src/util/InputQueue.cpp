@@ -0,0 +1,77 @@
+#include "InputQueue.h"
+
+namespace util
+{
+InputQueue::InputQueue() : slots(std::make_unique<Slot[]>(CAPACITY))
+{
+    for (std::size_t i = 0; i < CAPACITY; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+InputQueue::~InputQueue()
+{
+    stop();
+}
+
+void InputQueue::start()
+{
+    if (!isWatching) {
+        SDL_AddEventWatch(&InputQueue::onEvent, this);
+        isWatching = true;
+    }
+}
+
+void InputQueue::stop()
+{
+    if (isWatching) {
+        SDL_DelEventWatch(&InputQueue::onEvent, this);
+        isWatching = false;
+    }
+}
+
+int InputQueue::onEvent(void* userdata, SDL_Event* event)
+{
+    auto* queue = static_cast<InputQueue*>(userdata);
+    if (!queue->push(*event, SDL_GetPerformanceCounter())) {
+        queue->numDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return 0; // ignored for event watches
+}
+
+bool InputQueue::push(const SDL_Event& event, std::uint64_t timestamp)
+{
+    auto pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+        auto& slot = slots[pos & (CAPACITY - 1)];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+        if (diff == 0) {
+            // the slot is free, try to claim it
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.event = InputEvent{.event = event, .timestamp = timestamp};
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false; // full, the consumer hasn't read this slot yet
+        } else {
+            // another producer claimed the slot
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool InputQueue::pop(InputEvent& e)
+{
+    auto& slot = slots[tail & (CAPACITY - 1)];
+    const auto sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != tail + 1) {
+        return false; // empty or still being written
+    }
+    e = slot.event;
+    slot.sequence.store(tail + CAPACITY, std::memory_order_release);
+    ++tail;
+    return true;
+}
+}
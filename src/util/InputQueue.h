@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <SDL.h>
+
+namespace util
+{
+struct InputEvent {
+    SDL_Event event;
+    std::uint64_t timestamp; // SDL_GetPerformanceCounter() when SDL queued the event
+};
+
+// Timestamps SDL events the moment they're queued (from an event watch, which runs
+// on whichever thread pushes the event) and stores them in a bounded lock-free
+// queue. This way the game can assign events to simulation steps by the time they
+// happened instead of the time it got to process them.
+// Events which don't fit are dropped.
+class InputQueue {
+public:
+    InputQueue();
+    ~InputQueue();
+
+    InputQueue(const InputQueue&) = delete;
+    InputQueue& operator=(const InputQueue&) = delete;
+
+    // adds/removes the event watch, SDL has to be initialized
+    void start();
+    void stop();
+
+    // consumer (one thread only)
+    bool pop(InputEvent& e);
+
+    std::size_t getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+
+private:
+    static int onEvent(void* userdata, SDL_Event* event);
+    // producers (any thread)
+    bool push(const SDL_Event& event, std::uint64_t timestamp);
+
+    static constexpr std::size_t CAPACITY = 1024; // must be a power of two
+
+    struct Slot {
+        // equals to the position when the slot can be written,
+        // position + 1 when it can be read
+        std::atomic<std::size_t> sequence;
+        InputEvent event;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::size_t tail{0};
+    std::atomic<std::size_t> numDropped{0};
+    bool isWatching{false};
+};
+}
@@ -0,0 +1,177 @@
+#include "LZ4.h"
+
+#include <cstring>
+
+namespace
+{
+constexpr std::size_t MIN_MATCH = 4;
+// the last match must start at least 12 bytes before the end of the block
+constexpr std::size_t MF_LIMIT = 12;
+// the last 5 bytes are always literals
+constexpr std::size_t LAST_LITERALS = 5;
+constexpr std::size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 16;
+
+std::uint32_t read32(const std::uint8_t* p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+std::uint32_t hash(std::uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void writeLength(std::vector<std::uint8_t>& dst, std::size_t len)
+{
+    while (len >= 255) {
+        dst.push_back(255);
+        len -= 255;
+    }
+    dst.push_back(static_cast<std::uint8_t>(len));
+}
+
+void writeSequence(
+    std::vector<std::uint8_t>& dst,
+    const std::uint8_t* literals,
+    std::size_t numLiterals,
+    std::size_t offset,
+    std::size_t matchLength)
+{
+    const auto litToken = numLiterals < 15 ? numLiterals : 15;
+    std::size_t matchToken = 0;
+    if (matchLength != 0) {
+        const auto ml = matchLength - MIN_MATCH;
+        matchToken = ml < 15 ? ml : 15;
+    }
+    dst.push_back(static_cast<std::uint8_t>((litToken << 4) | matchToken));
+    if (numLiterals >= 15) {
+        writeLength(dst, numLiterals - 15);
+    }
+    dst.insert(dst.end(), literals, literals + numLiterals);
+
+    if (matchLength == 0) {
+        return; // last sequence
+    }
+    dst.push_back(static_cast<std::uint8_t>(offset & 0xff));
+    dst.push_back(static_cast<std::uint8_t>(offset >> 8));
+    if (matchLength - MIN_MATCH >= 15) {
+        writeLength(dst, matchLength - MIN_MATCH - 15);
+    }
+}
+}
+
+namespace util
+{
+std::vector<std::uint8_t> compressLZ4(std::span<const std::uint8_t> src)
+{
+    std::vector<std::uint8_t> dst;
+    dst.reserve(src.size() / 2 + 16);
+
+    const auto* data = src.data();
+    const auto size = src.size();
+
+    std::size_t anchor = 0;
+    if (size > MF_LIMIT) {
+        std::vector<std::uint32_t> table(1 << HASH_BITS, 0);
+        const auto matchLimit = size - LAST_LITERALS;
+        std::size_t pos = 0;
+        while (pos + MF_LIMIT < size) {
+            const auto seq = read32(data + pos);
+            const auto h = hash(seq);
+            const std::size_t candidate = table[h];
+            table[h] = static_cast<std::uint32_t>(pos);
+
+            if (candidate < pos && pos - candidate <= MAX_OFFSET &&
+                read32(data + candidate) == seq) {
+                auto len = MIN_MATCH;
+                while (pos + len < matchLimit && data[candidate + len] == data[pos + len]) {
+                    ++len;
+                }
+                writeSequence(dst, data + anchor, pos - anchor, pos - candidate, len);
+                pos += len;
+                anchor = pos;
+            } else {
+                ++pos;
+            }
+        }
+    }
+
+    writeSequence(dst, data + anchor, size - anchor, 0, 0);
+    return dst;
+}
+
+bool decompressLZ4(std::span<const std::uint8_t> src, std::span<std::uint8_t> dst)
+{
+    const auto* ip = src.data();
+    const auto* const iend = ip + src.size();
+    auto* op = dst.data();
+    auto* const oend = op + dst.size();
+
+    const auto readLength = [&ip, iend](std::size_t& len) {
+        std::uint8_t b;
+        do {
+            if (ip >= iend) {
+                return false;
+            }
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < iend) {
+        const auto token = *ip++;
+
+        // literals
+        std::size_t numLiterals = token >> 4;
+        if (numLiterals == 15 && !readLength(numLiterals)) {
+            return false;
+        }
+        if (numLiterals > static_cast<std::size_t>(iend - ip) ||
+            numLiterals > static_cast<std::size_t>(oend - op)) {
+            return false;
+        }
+        if (numLiterals != 0) { // op is null when dst is empty
+            std::memcpy(op, ip, numLiterals);
+        }
+        ip += numLiterals;
+        op += numLiterals;
+
+        if (ip == iend) {
+            break; // last sequence has no match
+        }
+
+        // match
+        if (iend - ip < 2) {
+            return false;
+        }
+        const std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        std::size_t matchLength = token & 0xf;
+        if (matchLength == 15 && !readLength(matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+
+        if (offset == 0 || offset > static_cast<std::size_t>(op - dst.data()) ||
+            matchLength > static_cast<std::size_t>(oend - op)) {
+            return false;
+        }
+        const auto* match = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+        } else {
+            // overlaps the output (repeats the last offset bytes) - copy byte by byte
+            for (std::size_t i = 0; i < matchLength; ++i) {
+                op[i] = match[i];
+            }
+        }
+        op += matchLength;
+    }
+
+    return op == oend;
+}
+}
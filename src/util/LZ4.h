@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace util
+{
+// Minimal implementation of the LZ4 block format (no frame format, no dictionaries).
+// Compression is a simple greedy hash-chain-less matcher - it's only used offline
+// by the asset packer, decompression is what matters at runtime.
+std::vector<std::uint8_t> compressLZ4(std::span<const std::uint8_t> src);
+
+// Returns false if the data is malformed or doesn't decompress to exactly dst.size() bytes
+bool decompressLZ4(std::span<const std::uint8_t> src, std::span<std::uint8_t> dst);
+}
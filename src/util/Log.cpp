@@ -0,0 +1,457 @@
+#include "Log.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct RecordHeader {
+    std::uint32_t size;
+    util::LogLevel level;
+    std::int64_t time; // ns since the logger was created
+    const char* format;
+};
+
+// Single producer (the owning thread), single consumer (whoever holds the flush mutex).
+// Records are stored back to back and wrap around the end of the buffer.
+class LogRing {
+public:
+    bool push(const std::uint8_t* data, std::size_t size)
+    {
+        const auto h = head.load(std::memory_order_relaxed);
+        const auto t = tail.load(std::memory_order_acquire);
+        if (CAPACITY - (h - t) < size) {
+            return false;
+        }
+        copyIn(h, data, size);
+        head.store(h + size, std::memory_order_release);
+        return true;
+    }
+
+    template<typename Func>
+    void popAll(Func&& f)
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        const auto h = head.load(std::memory_order_acquire);
+        std::array<std::uint8_t, util::detail::LogRecord::MAX_SIZE> record;
+        while (t != h) {
+            std::uint32_t size;
+            copyOut(t, reinterpret_cast<std::uint8_t*>(&size), sizeof(size));
+            copyOut(t, record.data(), size);
+            f(record.data(), size);
+            t += size;
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+private:
+    static constexpr std::size_t CAPACITY = 64 * 1024; // must be a power of two
+
+    void copyIn(std::size_t pos, const std::uint8_t* src, std::size_t size)
+    {
+        const auto offset = pos & (CAPACITY - 1);
+        const auto firstPart = std::min(size, CAPACITY - offset);
+        std::memcpy(&buffer[offset], src, firstPart);
+        std::memcpy(&buffer[0], src + firstPart, size - firstPart);
+    }
+
+    void copyOut(std::size_t pos, std::uint8_t* dst, std::size_t size) const
+    {
+        const auto offset = pos & (CAPACITY - 1);
+        const auto firstPart = std::min(size, CAPACITY - offset);
+        std::memcpy(dst, &buffer[offset], firstPart);
+        std::memcpy(dst + firstPart, &buffer[0], size - firstPart);
+    }
+
+    std::array<std::uint8_t, CAPACITY> buffer;
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+// reads arguments back in the order LogRecord::add wrote them
+class ArgReader {
+public:
+    ArgReader(const std::uint8_t* data, std::size_t size) : ptr(data), end(data + size) {}
+
+    bool next(util::detail::LogArgType& type)
+    {
+        if (ptr >= end) {
+            return false;
+        }
+        type = static_cast<util::detail::LogArgType>(*ptr++);
+        return true;
+    }
+
+    template<typename T>
+    T read()
+    {
+        T v;
+        std::memcpy(&v, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return v;
+    }
+
+    std::string_view readString()
+    {
+        const auto len = read<std::uint16_t>();
+        std::string_view s{reinterpret_cast<const char*>(ptr), len};
+        ptr += len;
+        return s;
+    }
+
+private:
+    const std::uint8_t* ptr;
+    const std::uint8_t* end;
+};
+
+struct Arg {
+    util::detail::LogArgType type;
+    std::int64_t i{0};
+    double d{0.0};
+    std::string_view s;
+};
+
+template<typename T>
+void appendFormatted(std::string& out, const char* spec, T value)
+{
+    const auto n = std::snprintf(nullptr, 0, spec, value);
+    if (n <= 0) {
+        return;
+    }
+    const auto pos = out.size();
+    out.resize(pos + n + 1);
+    std::snprintf(&out[pos], n + 1, spec, value);
+    out.resize(pos + n);
+}
+
+// Formats a printf-style message. Length modifiers in the format string are ignored:
+// integers are stored as 64-bit values, so the matching ones are used instead.
+void formatMessage(std::string& out, const char* format, ArgReader args)
+{
+    const auto nextArg = [&args](Arg& arg) {
+        if (!args.next(arg.type)) {
+            return false;
+        }
+        using util::detail::LogArgType;
+        switch (arg.type) {
+        case LogArgType::Int:
+        case LogArgType::UInt:
+        case LogArgType::Pointer:
+            arg.i = args.read<std::int64_t>();
+            arg.d = static_cast<double>(arg.i);
+            break;
+        case LogArgType::Double:
+            arg.d = args.read<double>();
+            arg.i = static_cast<std::int64_t>(arg.d);
+            break;
+        case LogArgType::String:
+            arg.s = args.readString();
+            break;
+        }
+        return true;
+    };
+
+    std::string spec;
+    std::string str;
+    for (const char* p = format; *p;) {
+        if (*p != '%') {
+            const char* next = std::strchr(p, '%');
+            const auto len = next ? next - p : std::strlen(p);
+            out.append(p, len);
+            p += len;
+            continue;
+        }
+        if (p[1] == '%') {
+            out += '%';
+            p += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion
+        const char* start = p++;
+        spec.assign(1, '%');
+        while (*p && std::strchr("-+ #0123456789.", *p)) {
+            spec += *p++;
+        }
+        while (*p && std::strchr("hlLjzt", *p)) {
+            ++p;
+        }
+        const char conversion = *p;
+        if (conversion == '\0') {
+            out.append(start);
+            break;
+        }
+        ++p;
+
+        Arg arg;
+        if (!nextArg(arg)) {
+            out.append(start, p);
+            continue;
+        }
+
+        switch (conversion) {
+        case 'd':
+        case 'i':
+            appendFormatted(out, (spec + "lld").c_str(), static_cast<long long>(arg.i));
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            spec += "ll";
+            spec += conversion;
+            appendFormatted(out, spec.c_str(), static_cast<unsigned long long>(arg.i));
+            break;
+        case 'c':
+            appendFormatted(out, (spec + 'c').c_str(), static_cast<int>(arg.i));
+            break;
+        case 'p':
+            appendFormatted(
+                out, "%p", reinterpret_cast<void*>(static_cast<std::uintptr_t>(arg.i)));
+            break;
+        case 's':
+            if (spec.size() == 1) {
+                out += arg.s;
+            } else {
+                str = arg.s;
+                appendFormatted(out, (spec + 's').c_str(), str.c_str());
+            }
+            break;
+        default: // floating point
+            spec += conversion;
+            appendFormatted(out, spec.c_str(), arg.d);
+            break;
+        }
+    }
+}
+
+const char* getLevelName(util::LogLevel level)
+{
+    switch (level) {
+    case util::LogLevel::Debug:
+        return "debug";
+    case util::LogLevel::Info:
+        return "info";
+    case util::LogLevel::Warning:
+        return "warn";
+    case util::LogLevel::Error:
+        return "error";
+    }
+    return "";
+}
+
+class Logger {
+public:
+    ~Logger()
+    {
+        stopWriter();
+        flush();
+    }
+
+    LogRing& getThreadRing()
+    {
+        thread_local LogRing* ring = nullptr;
+        if (!ring) {
+            // rings are never freed, a thread's messages are written after it exits
+            std::lock_guard lock(ringsMutex);
+            ring = rings.emplace_back(std::make_unique<LogRing>()).get();
+        }
+        return *ring;
+    }
+
+    std::int64_t getTime() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime)
+            .count();
+    }
+
+    void flush()
+    {
+        std::lock_guard flushLock(flushMutex);
+        {
+            std::lock_guard lock(ringsMutex);
+            for (const auto& ring : rings) {
+                ring->popAll([this](const std::uint8_t* data, std::size_t size) {
+                    records.emplace_back(data, data + size);
+                });
+            }
+        }
+        if (records.empty()) {
+            return;
+        }
+
+        // each ring is ordered, but messages from different threads have to be merged
+        std::stable_sort(records.begin(), records.end(), [](const auto& a, const auto& b) {
+            return getHeader(a).time < getHeader(b).time;
+        });
+
+        for (const auto& record : records) {
+            const auto header = getHeader(record);
+            appendFormatted(
+                output, "[%9.3f] ", static_cast<double>(header.time) / 1'000'000'000.0);
+            output += getLevelName(header.level);
+            output += ": ";
+            formatMessage(
+                output,
+                header.format,
+                ArgReader(record.data() + sizeof(header), record.size() - sizeof(header)));
+            output += '\n';
+        }
+        std::fwrite(output.data(), 1, output.size(), stdout);
+        std::fflush(stdout);
+
+        records.clear();
+        output.clear();
+    }
+
+    void startWriter()
+    {
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+        if (writer.joinable()) {
+            return;
+        }
+        isWriterRunning = true;
+        writer = std::thread([this]() {
+            std::unique_lock lock(writerMutex);
+            while (isWriterRunning) {
+                lock.unlock();
+                flush();
+                lock.lock();
+                writerCondition.wait_for(lock, std::chrono::milliseconds(10));
+            }
+        });
+#endif
+    }
+
+    void stopWriter()
+    {
+        if (!writer.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard lock(writerMutex);
+            isWriterRunning = false;
+        }
+        writerCondition.notify_one();
+        writer.join();
+    }
+
+private:
+    static RecordHeader getHeader(const std::vector<std::uint8_t>& record)
+    {
+        RecordHeader header;
+        std::memcpy(&header, record.data(), sizeof(header));
+        return header;
+    }
+
+    const Clock::time_point startTime{Clock::now()};
+
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<LogRing>> rings;
+
+    // only one thread consumes the rings at a time
+    std::mutex flushMutex;
+    std::vector<std::vector<std::uint8_t>> records;
+    std::string output;
+
+    std::thread writer;
+    std::mutex writerMutex;
+    std::condition_variable writerCondition;
+    bool isWriterRunning{false};
+};
+
+Logger& getLogger()
+{
+    static Logger logger;
+    return logger;
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+void startLogWriter()
+{
+    getLogger().startWriter();
+}
+
+void stopLogWriter()
+{
+    getLogger().stopWriter();
+    getLogger().flush();
+}
+
+void flushLog()
+{
+    getLogger().flush();
+}
+
+namespace detail
+{
+LogRecord::LogRecord(LogLevel level, const char* format)
+{
+    const RecordHeader header{
+        .size = 0, // set by commit()
+        .level = level,
+        .time = getLogger().getTime(),
+        .format = format,
+    };
+    std::memcpy(data.data(), &header, sizeof(header));
+    size = sizeof(header);
+}
+
+void LogRecord::addString(std::string_view s)
+{
+    // marks strings which didn't fit
+    constexpr std::string_view ellipsis = "...";
+    if (size + 1 + sizeof(std::uint16_t) + ellipsis.size() > MAX_SIZE) {
+        return;
+    }
+    const auto maxLen = MAX_SIZE - size - 1 - sizeof(std::uint16_t);
+    const bool isTruncated = s.size() > maxLen;
+    const auto len = static_cast<std::uint16_t>(isTruncated ? maxLen : s.size());
+    const auto numCopied = isTruncated ? len - ellipsis.size() : len;
+    data[size++] = static_cast<std::uint8_t>(LogArgType::String);
+    std::memcpy(&data[size], &len, sizeof(len));
+    size += sizeof(len);
+    std::memcpy(&data[size], s.data(), numCopied);
+    if (isTruncated) {
+        std::memcpy(&data[size + numCopied], ellipsis.data(), ellipsis.size());
+    }
+    size += len;
+}
+
+void LogRecord::commit()
+{
+    const auto recordSize = static_cast<std::uint32_t>(size);
+    std::memcpy(data.data() + offsetof(RecordHeader, size), &recordSize, sizeof(recordSize));
+
+    auto& logger = getLogger();
+    auto& ring = logger.getThreadRing();
+    if (!ring.push(data.data(), size)) {
+        // the writer can't keep up (or isn't running), make room
+        logger.flush();
+        ring.push(data.data(), size);
+    }
+
+    const auto level = static_cast<LogLevel>(data[offsetof(RecordHeader, level)]);
+    if (level == LogLevel::Error) {
+        // don't lose the message if the program asserts or crashes right after it
+        logger.flush();
+    }
+}
+
+} // end of namespace detail
+} // end of namespace util
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace util
+{
+// Logging only copies the arguments into a lock-free ring buffer owned by the calling
+// thread. Messages are formatted and written later by the writer thread (or by
+// flushLog() if it's not running), errors are written right away.
+// Format strings are printf-style and must outlive the program (i.e. be literals).
+enum class LogLevel : std::uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error,
+};
+
+// starts the writer thread, does nothing on web builds without pthreads
+void startLogWriter();
+// writes everything which was logged and stops the writer thread
+void stopLogWriter();
+// formats and writes everything logged so far on the calling thread
+void flushLog();
+
+namespace detail
+{
+enum class LogArgType : std::uint8_t {
+    Int,
+    UInt,
+    Double,
+    String,
+    Pointer,
+};
+
+// Message with copies of its arguments. Strings which don't fit are truncated and end
+// with "...", long texts should be logged line by line.
+class LogRecord {
+public:
+    static constexpr std::size_t MAX_SIZE = 1024;
+
+    LogRecord(LogLevel level, const char* format);
+
+    template<typename T>
+    void add(const T& v)
+    {
+        if constexpr (std::is_floating_point_v<T>) {
+            addValue(LogArgType::Double, static_cast<double>(v));
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            addValue(LogArgType::Int, static_cast<std::int64_t>(v));
+        } else if constexpr (std::is_integral_v<T>) {
+            addValue(LogArgType::UInt, static_cast<std::uint64_t>(v));
+        } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+            const char* s = v;
+            addString(s ? s : "(null)");
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            addString(v);
+        } else if constexpr (std::is_pointer_v<T>) {
+            addValue(LogArgType::Pointer, reinterpret_cast<std::uintptr_t>(v));
+        } else {
+            static_assert(sizeof(T) == 0, "unsupported log argument type");
+        }
+    }
+
+    // pushes the record into the calling thread's ring buffer
+    void commit();
+
+private:
+    template<typename T>
+    void addValue(LogArgType type, T v)
+    {
+        if (size + 1 + sizeof(T) > MAX_SIZE) {
+            return;
+        }
+        data[size++] = static_cast<std::uint8_t>(type);
+        std::memcpy(&data[size], &v, sizeof(T));
+        size += sizeof(T);
+    }
+
+    void addString(std::string_view s);
+
+    std::array<std::uint8_t, MAX_SIZE> data;
+    std::size_t size{0};
+};
+
+template<typename... Args>
+void log(LogLevel level, const char* format, const Args&... args)
+{
+    LogRecord record(level, format);
+    (record.add(args), ...);
+    record.commit();
+}
+
+// never called, only lets the compiler check format strings against arguments
+#ifdef __GNUC__
+[[gnu::format(printf, 1, 2)]]
+#endif
+inline void checkLogFormat(const char*, ...)
+{}
+
+} // end of namespace detail
+} // end of namespace util
+
+// messages below this level are compiled out
+#ifndef LOG_MIN_LEVEL
+#ifdef SHIPPING_BUILD
+#define LOG_MIN_LEVEL ::util::LogLevel::Warning
+#else
+#define LOG_MIN_LEVEL ::util::LogLevel::Debug
+#endif
+#endif
+
+#define LOG_MESSAGE(level, ...)                                                                    \
+    do {                                                                                           \
+        if constexpr ((level) >= (LOG_MIN_LEVEL)) {                                                \
+            if (false) {                                                                           \
+                ::util::detail::checkLogFormat(__VA_ARGS__);                                       \
+            }                                                                                      \
+            ::util::detail::log(level, __VA_ARGS__);                                               \
+        }                                                                                          \
+    } while (false)
+
+#define LOG_DEBUG(...) LOG_MESSAGE(::util::LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_MESSAGE(::util::LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) LOG_MESSAGE(::util::LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_MESSAGE(::util::LogLevel::Error, __VA_ARGS__)
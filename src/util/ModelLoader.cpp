@@ -0,0 +1,56 @@
+#include "ModelLoader.h"
+
+#include <cassert>
+
+#include <Graphics/Model.h>
+#include <Graphics/ModelData.h>
+#include <util/CookedModel.h>
+#include <util/Log.h>
+#include <util/VirtualFS.h>
+
+#ifndef SHIPPING_BUILD
+#include <util/GltfLoader.h>
+#endif
+
+namespace util
+{
+Model loadModel(const std::filesystem::path& path, Mesh::Residency residency)
+{
+    const auto file = util::readAssetFile(path);
+    if (!file) {
+        LOG_ERROR("Failed to open model: %s", path.string().c_str());
+        assert(false);
+        return {};
+    }
+
+    ModelData data;
+    if (isCookedModel(file.getBytes())) {
+        if (!readCookedModel(file.getBytes(), data)) {
+            LOG_ERROR("Failed to read cooked model: %s", path.string().c_str());
+            assert(false);
+            return {};
+        }
+    } else {
+#ifdef SHIPPING_BUILD
+        LOG_ERROR("Only cooked models can be loaded in shipping builds: %s", path.string().c_str());
+        assert(false);
+#else
+        data = loadGltfModel(path, file.getBytes());
+#endif
+    }
+
+    Model model{
+        .position = data.position,
+        .rotation = data.rotation,
+        .scale = data.scale,
+        .meshes = std::vector<Mesh>(data.meshes.size()),
+        .skeleton = std::move(data.skeleton),
+        .animations = std::move(data.animations),
+    };
+    for (std::size_t i = 0; i < data.meshes.size(); ++i) {
+        model.meshes[i].data = std::move(data.meshes[i]);
+        model.meshes[i].residency = residency;
+    }
+    return model;
+}
+}
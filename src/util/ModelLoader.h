@@ -0,0 +1,15 @@
+#pragma once
+
+#include <filesystem>
+
+#include <Graphics/Mesh.h>
+
+struct Model;
+
+namespace util
+{
+// Loads cooked models (see CookedModel.h) or glTF files (except in shipping builds)
+Model loadModel(
+    const std::filesystem::path& path,
+    Mesh::Residency residency = Mesh::Residency::Keep);
+}
@@ -0,0 +1,167 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+// index of the worker's queue, 0 for threads not owned by a scheduler
+thread_local std::size_t currentQueueIndex = 0;
+thread_local const util::TaskScheduler* currentScheduler = nullptr;
+}
+
+namespace util
+{
+TaskScheduler::TaskScheduler(std::size_t numWorkers)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    numWorkers = 0; // no threads - fall back to serial execution
+#endif
+    queues.resize(numWorkers + 1);
+    for (auto& queue : queues) {
+        queue = std::make_unique<TaskQueue>();
+    }
+
+    workers.reserve(numWorkers);
+    for (std::size_t i = 0; i < numWorkers; ++i) {
+        workers.emplace_back([this, i]() { workerLoop(i + 1); });
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard lock(wakeMutex);
+        isRunning = false;
+    }
+    wakeCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::size_t TaskScheduler::getDefaultWorkerCount()
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 0;
+#else
+    const auto numThreads = std::thread::hardware_concurrency();
+    return numThreads > 1 ? numThreads - 1 : 0;
+#endif
+}
+
+void TaskScheduler::parallelFor(std::size_t count, std::size_t grainSize, const RangeFunc& f)
+{
+    if (count == 0) {
+        return;
+    }
+    grainSize = std::max<std::size_t>(grainSize, 1);
+
+    // not worth splitting
+    if (workers.empty() || count <= grainSize) {
+        f(0, count);
+        return;
+    }
+
+    const auto numTasks = (count + grainSize - 1) / grainSize;
+    std::atomic<std::size_t> remaining{numTasks};
+
+    // distribute tasks between all queues so that workers rarely have to steal
+    for (std::size_t i = 0; i < numTasks; ++i) {
+        Task task{
+            .func = &f,
+            .begin = i * grainSize,
+            .end = std::min(count, (i + 1) * grainSize),
+            .remaining = &remaining,
+        };
+        auto& queue = *queues[i % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    {
+        std::lock_guard lock(wakeMutex);
+        numQueuedTasks += numTasks;
+    }
+    wakeCondition.notify_all();
+
+    // help with execution until all tasks of this loop are done
+    const auto queueIndex = getCurrentQueueIndex();
+    while (remaining.load(std::memory_order_acquire) != 0) {
+        Task task;
+        if (findTask(queueIndex, task)) {
+            runTask(task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskScheduler::workerLoop(std::size_t queueIndex)
+{
+    currentQueueIndex = queueIndex;
+    currentScheduler = this;
+
+    while (true) {
+        Task task;
+        if (findTask(queueIndex, task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock lock(wakeMutex);
+        wakeCondition.wait(lock, [this]() { return !isRunning || numQueuedTasks != 0; });
+        if (!isRunning) {
+            return;
+        }
+    }
+}
+
+bool TaskScheduler::popTask(std::size_t queueIndex, Task& task)
+{
+    auto& queue = *queues[queueIndex];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool TaskScheduler::stealTask(std::size_t thiefIndex, Task& task)
+{
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+        auto& queue = *queues[(thiefIndex + i) % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskScheduler::findTask(std::size_t queueIndex, Task& task)
+{
+    if (popTask(queueIndex, task) || stealTask(queueIndex, task)) {
+        numQueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void TaskScheduler::runTask(const Task& task)
+{
+    assert(task.func);
+    (*task.func)(task.begin, task.end);
+    task.remaining->fetch_sub(1, std::memory_order_release);
+}
+
+std::size_t TaskScheduler::getCurrentQueueIndex() const
+{
+    // parallelFor can be called from inside of a task
+    return currentScheduler == this ? currentQueueIndex : 0;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util
+{
+// Work-stealing scheduler for data-parallel loops.
+// Each worker (and the thread calling parallelFor) owns a queue of range tasks:
+// it takes tasks from the back of its own queue and steals from the front
+// of other queues when it runs out of work.
+// On web builds without pthreads everything runs serially on the calling thread.
+class TaskScheduler {
+public:
+    using RangeFunc = std::function<void(std::size_t begin, std::size_t end)>;
+
+    // numWorkers doesn't include the calling thread which also executes tasks
+    explicit TaskScheduler(std::size_t numWorkers = getDefaultWorkerCount());
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Calls f(begin, end) for sub-ranges of [0, count) which are at most
+    // grainSize elements long. Returns when the whole range has been processed.
+    void parallelFor(std::size_t count, std::size_t grainSize, const RangeFunc& f);
+
+    std::size_t getNumWorkers() const { return workers.size(); }
+
+    static std::size_t getDefaultWorkerCount();
+
+private:
+    struct Task {
+        const RangeFunc* func{nullptr};
+        std::size_t begin{0};
+        std::size_t end{0};
+        std::atomic<std::size_t>* remaining{nullptr};
+    };
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(std::size_t queueIndex);
+
+    bool popTask(std::size_t queueIndex, Task& task);
+    bool stealTask(std::size_t thiefIndex, Task& task);
+    bool findTask(std::size_t queueIndex, Task& task);
+    void runTask(const Task& task);
+
+    std::size_t getCurrentQueueIndex() const;
+
+    // queues[0] belongs to threads which are not workers
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<std::size_t> numQueuedTasks{0};
+    bool isRunning{true};
+};
+}
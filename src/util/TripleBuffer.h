@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace util
+{
+// Lock-free triple buffer for a single producer and a single consumer.
+// The producer always has a buffer to write into and never waits for
+// the consumer; the consumer always gets the most recently published buffer
+// (older unconsumed buffers are dropped).
+template<typename T>
+class TripleBuffer {
+public:
+    // producer
+    T& getWriteBuffer() { return buffers[writeIndex]; }
+    void publish()
+    {
+        const auto prev = middle.exchange(writeIndex | NEW_DATA_BIT, std::memory_order_acq_rel);
+        writeIndex = prev & INDEX_MASK;
+        middle.notify_one();
+    }
+
+    // consumer
+    // returns false if nothing new was published since the last call
+    bool acquireLatest()
+    {
+        if ((middle.load(std::memory_order_relaxed) & NEW_DATA_BIT) == 0) {
+            return false;
+        }
+        const auto prev = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = prev & INDEX_MASK;
+        return true;
+    }
+
+    // blocks until something new is published or wake() is called
+    void waitForNew()
+    {
+        auto state = middle.load(std::memory_order_relaxed);
+        while ((state & NEW_DATA_BIT) == 0 && !woken.load(std::memory_order_relaxed)) {
+            middle.wait(state);
+            state = middle.load(std::memory_order_relaxed);
+        }
+    }
+
+    // unblocks waitForNew (e.g. on shutdown)
+    void wake()
+    {
+        woken = true;
+        // change the value so that the waiting thread always wakes up
+        middle.fetch_or(WAKE_BIT);
+        middle.notify_all();
+    }
+
+    T& getReadBuffer() { return buffers[readIndex]; }
+
+private:
+    static constexpr std::uint8_t INDEX_MASK = 0b11;
+    static constexpr std::uint8_t NEW_DATA_BIT = 0b100;
+    static constexpr std::uint8_t WAKE_BIT = 0b1000;
+
+    std::array<T, 3> buffers;
+    std::uint8_t writeIndex{0}; // owned by producer
+    std::uint8_t readIndex{1}; // owned by consumer
+    std::atomic<std::uint8_t> middle{2}; // index + flags
+    std::atomic<bool> woken{false};
+};
+}
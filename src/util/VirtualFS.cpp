@@ -0,0 +1,312 @@
+#include "VirtualFS.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <util/AssetPackFormat.h>
+#include <util/LZ4.h>
+#include <util/Log.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+struct MountedPack {
+    MountedPack() = default;
+    ~MountedPack();
+
+    MountedPack(const MountedPack&) = delete;
+    MountedPack& operator=(const MountedPack&) = delete;
+
+    bool map(const std::filesystem::path& path);
+    bool readTOC();
+
+    const AssetPackEntry* findEntry(std::string_view name) const;
+    std::string_view getName(const AssetPackEntry& entry) const;
+
+    std::filesystem::path path;
+    const std::uint8_t* data{nullptr};
+    std::size_t size{0};
+
+    // copied out of the mapping so that we don't depend on its alignment
+    std::vector<AssetPackEntry> entries;
+    std::string_view names;
+
+#ifdef _WIN32
+    HANDLE file{INVALID_HANDLE_VALUE};
+    HANDLE mapping{nullptr};
+#elif defined(__EMSCRIPTEN__)
+    // mmap of a MEMFS file copies it too, so the pack is read into the buffer
+    // and the preloaded file is removed from MEMFS (see map)
+    std::vector<std::uint8_t> buffer;
+#endif
+};
+
+std::vector<std::unique_ptr<MountedPack>> mountedPacks;
+
+#ifdef _WIN32
+bool MountedPack::map(const std::filesystem::path& path)
+{
+    file = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        return false;
+    }
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        return false;
+    }
+
+    data = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+    return data != nullptr;
+}
+
+MountedPack::~MountedPack()
+{
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+}
+#elif defined(__EMSCRIPTEN__)
+bool MountedPack::map(const std::filesystem::path& path)
+{
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) {
+        return false;
+    }
+    buffer.resize(static_cast<std::size_t>(f.tellg()));
+    f.seekg(0);
+    f.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+    if (!f) {
+        return false;
+    }
+    f.close();
+
+    // otherwise the pack would be kept in memory twice: in MEMFS and in the buffer
+    std::error_code ec;
+    if (!std::filesystem::remove(path, ec)) {
+        LOG_WARN("Failed to remove '%s' from MEMFS", path.string().c_str());
+    }
+
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+}
+
+MountedPack::~MountedPack() = default;
+#else
+bool MountedPack::map(const std::filesystem::path& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    // the mapping stays valid after closing the fd
+    void* ptr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+
+    data = static_cast<const std::uint8_t*>(ptr);
+    size = static_cast<std::size_t>(st.st_size);
+    return true;
+}
+
+MountedPack::~MountedPack()
+{
+    if (data) {
+        munmap(const_cast<std::uint8_t*>(data), size);
+    }
+}
+#endif
+
+bool MountedPack::readTOC()
+{
+    AssetPackHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != ASSET_PACK_MAGIC) {
+        LOG_ERROR("'%s' is not an asset pack", path.string().c_str());
+        return false;
+    }
+    if (header.version != ASSET_PACK_VERSION) {
+        LOG_ERROR(
+            "Asset pack '%s' has version %u, expected %u",
+            path.string().c_str(),
+            header.version,
+            ASSET_PACK_VERSION);
+        return false;
+    }
+
+    const auto entriesSize = std::size_t{header.numEntries} * sizeof(AssetPackEntry);
+    const auto namesOffset = sizeof(header) + entriesSize;
+    if (namesOffset + header.namesSize > size) {
+        return false;
+    }
+
+    entries.resize(header.numEntries);
+    std::memcpy(entries.data(), data + sizeof(header), entriesSize);
+    names = {reinterpret_cast<const char*>(data + namesOffset), header.namesSize};
+
+    for (const auto& entry : entries) {
+        if (entry.offset > size || entry.storedSize > size - entry.offset ||
+            std::size_t{entry.nameOffset} + entry.nameLength > names.size()) {
+            LOG_ERROR("Asset pack '%s' is corrupted", path.string().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view MountedPack::getName(const AssetPackEntry& entry) const
+{
+    return names.substr(entry.nameOffset, entry.nameLength);
+}
+
+const AssetPackEntry* MountedPack::findEntry(std::string_view name) const
+{
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), name, [this](const AssetPackEntry& e, std::string_view n) {
+            return getName(e) < n;
+        });
+    if (it == entries.end() || getName(*it) != name) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+util::FileData readEntry(const MountedPack& pack, const AssetPackEntry& entry)
+{
+    std::span<const std::uint8_t> stored{pack.data + entry.offset, entry.storedSize};
+    switch (entry.compression) {
+    case AssetPackCompression::None:
+        return util::FileData{stored};
+    case AssetPackCompression::LZ4: {
+        std::vector<std::uint8_t> buffer(entry.size);
+        if (!util::decompressLZ4(stored, buffer)) {
+            LOG_ERROR(
+                "Failed to decompress '%s' from '%s'",
+                std::string(pack.getName(entry)).c_str(),
+                pack.path.string().c_str());
+            return {};
+        }
+        return util::FileData{std::move(buffer)};
+    }
+    }
+    return {};
+}
+
+util::FileData readLooseFile(const std::filesystem::path& path)
+{
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) {
+        return {};
+    }
+
+    std::vector<std::uint8_t> buffer(static_cast<std::size_t>(f.tellg()));
+    f.seekg(0);
+    f.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+    if (!f) {
+        return {};
+    }
+    return util::FileData{std::move(buffer)};
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+FileData::FileData(std::span<const std::uint8_t> view) : bytes(view), found(true)
+{}
+
+FileData::FileData(std::vector<std::uint8_t> buffer) :
+    storage(std::move(buffer)), bytes(storage), found(true)
+{}
+
+std::string_view FileData::asString() const
+{
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+bool mountAssetPack(const std::filesystem::path& packPath)
+{
+    auto pack = std::make_unique<MountedPack>();
+    pack->path = packPath;
+    if (!pack->map(packPath) || !pack->readTOC()) {
+        LOG_ERROR("Failed to mount asset pack '%s'", packPath.string().c_str());
+        return false;
+    }
+
+    mountedPacks.push_back(std::move(pack));
+    return true;
+}
+
+void unmountAssetPacks()
+{
+    mountedPacks.clear();
+}
+
+FileData readAssetFile(const std::filesystem::path& path)
+{
+    const auto name = path.lexically_normal().generic_string();
+    for (auto it = mountedPacks.rbegin(); it != mountedPacks.rend(); ++it) {
+        const auto& pack = **it;
+        if (const auto* entry = pack.findEntry(name)) {
+            return readEntry(pack, *entry);
+        }
+    }
+    return readLooseFile(path);
+}
+
+bool assetFileExists(const std::filesystem::path& path)
+{
+    const auto name = path.lexically_normal().generic_string();
+    for (const auto& pack : mountedPacks) {
+        if (pack->findEntry(name)) {
+            return true;
+        }
+    }
+    return std::filesystem::is_regular_file(path);
+}
+
+} // end of namespace util
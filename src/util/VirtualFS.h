@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace util
+{
+// Contents of a file read through the VFS.
+// Either a view into a mounted pack (valid until the pack is unmounted)
+// or an owned buffer (decompressed entries and loose files).
+class FileData {
+public:
+    FileData() = default;
+    explicit FileData(std::span<const std::uint8_t> view);
+    explicit FileData(std::vector<std::uint8_t> buffer);
+
+    // move only
+    FileData(FileData&& o) = default;
+    FileData& operator=(FileData&& o) = default;
+
+    // no copies
+    FileData(const FileData& o) = delete;
+    FileData& operator=(const FileData& o) = delete;
+
+    std::span<const std::uint8_t> getBytes() const { return bytes; }
+    const std::uint8_t* data() const { return bytes.data(); }
+    std::size_t size() const { return bytes.size(); }
+    std::string_view asString() const;
+
+    // false if the file wasn't found (empty files are valid)
+    explicit operator bool() const { return found; }
+
+private:
+    std::vector<std::uint8_t> storage;
+    std::span<const std::uint8_t> bytes;
+    bool found{false};
+};
+
+// Maps an asset pack into memory (mmap on native, read into a single buffer on web).
+// Packs mounted later take priority. Mounting isn't thread-safe, reading is.
+bool mountAssetPack(const std::filesystem::path& packPath);
+void unmountAssetPacks();
+
+// Looks the file up in mounted packs and falls back to reading it from disk.
+// Paths are relative to the working dir, e.g. "assets/textures/shinji.png"
+FileData readAssetFile(const std::filesystem::path& path);
+bool assetFileExists(const std::filesystem::path& path);
+}
@@ -0,0 +1,497 @@
+// Headless checks of BVH, MeshBVH and SceneBVH: the tree's structure and ray casts and
+// overlap queries compared to brute-force loops over all triangles. Runs without and
+// with a scheduler (parallel binning and subtree builds).
+// Returns a non-zero exit code if any check fails.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <Graphics/BVH.h>
+#include <Graphics/MeshBVH.h>
+#include <Graphics/SceneBVH.h>
+#include <util/TaskScheduler.h>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/matrix.hpp>
+#include <glm/vec4.hpp>
+
+namespace
+{
+int numFailures = 0;
+
+void check(bool condition, const char* what)
+{
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        ++numFailures;
+    }
+}
+
+struct TriangleMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<std::uint16_t> indices;
+
+    std::size_t getNumTriangles() const { return indices.size() / 3; }
+    void getTriangle(std::size_t i, glm::vec3& a, glm::vec3& b, glm::vec3& c) const
+    {
+        a = positions[indices[i * 3]];
+        b = positions[indices[i * 3 + 1]];
+        c = positions[indices[i * 3 + 2]];
+    }
+};
+
+glm::vec3 randomPoint(std::mt19937& rng, float extent)
+{
+    std::uniform_real_distribution<float> dist(-extent, extent);
+    const auto x = dist(rng);
+    const auto y = dist(rng);
+    const auto z = dist(rng);
+    return {x, y, z};
+}
+
+// Small triangles scattered in a cube. There can be more triangles than 16-bit indices
+// can address vertices, so after every 21845 triangles the same vertices are reused
+// (in a rotated order).
+TriangleMesh makeTriangleSoup(std::size_t numTriangles, float extent, std::mt19937& rng)
+{
+    constexpr std::size_t MAX_CLUSTERS = 65536 / 3;
+    const auto numClusters = std::min(numTriangles, MAX_CLUSTERS);
+
+    TriangleMesh mesh;
+    for (std::size_t i = 0; i < numClusters; ++i) {
+        const auto center = randomPoint(rng, extent);
+        for (int v = 0; v < 3; ++v) {
+            mesh.positions.push_back(center + randomPoint(rng, 0.5f));
+        }
+    }
+    for (std::size_t i = 0; i < numTriangles; ++i) {
+        const auto first = (i % numClusters) * 3;
+        const auto rotation = (i / numClusters) % 3;
+        for (std::size_t v = 0; v < 3; ++v) {
+            mesh.indices.push_back(static_cast<std::uint16_t>(first + (v + rotation) % 3));
+        }
+    }
+    return mesh;
+}
+
+std::vector<AABB> getTriangleBounds(const TriangleMesh& mesh)
+{
+    std::vector<AABB> bounds(mesh.getNumTriangles());
+    for (std::size_t i = 0; i < bounds.size(); ++i) {
+        glm::vec3 a, b, c;
+        mesh.getTriangle(i, a, b, c);
+        bounds[i].grow(a);
+        bounds[i].grow(b);
+        bounds[i].grow(c);
+    }
+    return bounds;
+}
+
+bool contains(const glm::vec3& outerMin, const glm::vec3& outerMax, const AABB& inner)
+{
+    return outerMin.x <= inner.min.x && outerMin.y <= inner.min.y && outerMin.z <= inner.min.z &&
+           outerMax.x >= inner.max.x && outerMax.y >= inner.max.y && outerMax.z >= inner.max.z;
+}
+
+// Every node has to be reachable from the root exactly once, every primitive has to
+// be in exactly one leaf and parents' bounds have to contain their children.
+void checkStructure(const BVH& bvh, const std::vector<AABB>& bounds)
+{
+    const auto& nodes = bvh.getNodes();
+    const auto& primitives = bvh.getPrimitives();
+    std::vector<int> nodeVisits(nodes.size(), 0);
+    std::vector<int> primitiveVisits(bounds.size(), 0);
+    bool isBoundsValid = true;
+    bool isIndexValid = true;
+
+    std::vector<std::uint32_t> stack{0};
+    while (!stack.empty()) {
+        const auto index = stack.back();
+        stack.pop_back();
+        ++nodeVisits[index];
+        const auto& node = nodes[index];
+        if (node.isLeaf()) {
+            if (node.leftFirst + node.count > primitives.size()) {
+                isIndexValid = false;
+                continue;
+            }
+            for (auto i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                ++primitiveVisits[primitives[i]];
+                isBoundsValid &= contains(node.min, node.max, bounds[primitives[i]]);
+            }
+            continue;
+        }
+        if (node.leftFirst + 1 >= nodes.size()) {
+            isIndexValid = false;
+            continue;
+        }
+        for (auto child = node.leftFirst; child <= node.leftFirst + 1; ++child) {
+            const AABB childBounds{.min = nodes[child].min, .max = nodes[child].max};
+            isBoundsValid &= contains(node.min, node.max, childBounds);
+            stack.push_back(child);
+        }
+    }
+
+    check(isIndexValid, "child and primitive indices are in range");
+    check(isBoundsValid, "nodes contain their children and primitives");
+    check(
+        std::all_of(nodeVisits.begin(), nodeVisits.end(), [](int n) { return n == 1; }),
+        "every node is reachable exactly once");
+    check(
+        std::all_of(primitiveVisits.begin(), primitiveVisits.end(), [](int n) { return n == 1; }),
+        "every primitive is in exactly one leaf");
+}
+
+// Möller-Trumbore, returns a negative value if the triangle is missed
+float intersectTriangle(
+    const Ray& ray,
+    const glm::vec3& a,
+    const glm::vec3& b,
+    const glm::vec3& c)
+{
+    const auto edge1 = b - a;
+    const auto edge2 = c - a;
+    const auto p = glm::cross(ray.direction, edge2);
+    const auto det = glm::dot(edge1, p);
+    if (std::abs(det) < 1e-12f) {
+        return -1.f;
+    }
+    const auto s = ray.origin - a;
+    const auto u = glm::dot(s, p) / det;
+    const auto q = glm::cross(s, edge1);
+    const auto v = glm::dot(ray.direction, q) / det;
+    const auto t = glm::dot(edge2, q) / det;
+    if (u < 0.f || v < 0.f || u + v > 1.f || t < 0.f || t > ray.maxDistance) {
+        return -1.f;
+    }
+    return t;
+}
+
+// distance to the closest hit or a negative value if nothing is hit
+float raycastBruteForce(const TriangleMesh& mesh, const Ray& ray)
+{
+    float closest = -1.f;
+    for (std::size_t i = 0; i < mesh.getNumTriangles(); ++i) {
+        glm::vec3 a, b, c;
+        mesh.getTriangle(i, a, b, c);
+        const auto t = intersectTriangle(ray, a, b, c);
+        if (t >= 0.f && (closest < 0.f || t < closest)) {
+            closest = t;
+        }
+    }
+    return closest;
+}
+
+bool isSameDistance(float a, float b)
+{
+    return std::abs(a - b) <= 1e-4f * std::max(1.f, std::abs(b));
+}
+
+float distanceSqToSegment(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b)
+{
+    const auto ab = b - a;
+    const auto t = glm::clamp(glm::dot(p - a, ab) / glm::dot(ab, ab), 0.f, 1.f);
+    const auto d = p - (a + ab * t);
+    return glm::dot(d, d);
+}
+
+// projects p onto the triangle's plane, falls back to the edges if it lands outside
+float distanceSqToTriangle(
+    const glm::vec3& p,
+    const glm::vec3& a,
+    const glm::vec3& b,
+    const glm::vec3& c)
+{
+    const auto n = glm::cross(b - a, c - a);
+    const auto projected = p - n * (glm::dot(p - a, n) / glm::dot(n, n));
+    if (glm::dot(glm::cross(b - a, projected - a), n) >= 0.f &&
+        glm::dot(glm::cross(c - b, projected - b), n) >= 0.f &&
+        glm::dot(glm::cross(a - c, projected - c), n) >= 0.f) {
+        const auto d = p - projected;
+        return glm::dot(d, d);
+    }
+    return std::min(
+        {distanceSqToSegment(p, a, b), distanceSqToSegment(p, b, c), distanceSqToSegment(p, c, a)});
+}
+
+// triangles too close to the sphere's surface are skipped, rounding can go either way
+bool isNearSphereSurface(float distanceSq, float radius)
+{
+    return std::abs(std::sqrt(distanceSq) - radius) < 1e-3f;
+}
+
+std::vector<Ray> makeRays(std::size_t numRays, float extent, std::mt19937& rng)
+{
+    std::vector<Ray> rays(numRays);
+    for (std::size_t i = 0; i < numRays; ++i) {
+        rays[i].origin = randomPoint(rng, extent * 1.5f);
+        // aimed into the cube, so that most of them hit something
+        rays[i].direction = glm::normalize(randomPoint(rng, extent) - rays[i].origin);
+        if (i % 4 == 3) {
+            rays[i].maxDistance = extent * 0.5f;
+        }
+    }
+    return rays;
+}
+
+void checkMeshRaycasts(
+    const MeshBVH& bvh,
+    const TriangleMesh& mesh,
+    const std::vector<Ray>& rays)
+{
+    bool isHitCorrect = true;
+    bool isTriangleCorrect = true;
+    bool isOcclusionCorrect = true;
+    std::vector<float> expectedDistances(rays.size());
+    for (std::size_t i = 0; i < rays.size(); ++i) {
+        const auto& ray = rays[i];
+        const auto expected = raycastBruteForce(mesh, ray);
+        expectedDistances[i] = expected;
+        RayHit hit;
+        const auto found = bvh.raycast(ray, hit);
+        isOcclusionCorrect &= bvh.isOccluded(ray) == (expected >= 0.f);
+        if (found != (expected >= 0.f)) {
+            isHitCorrect = false;
+            continue;
+        }
+        if (!found) {
+            continue;
+        }
+        isHitCorrect &= isSameDistance(hit.distance, expected);
+        // the reported triangle has to be hit at the reported distance
+        glm::vec3 a, b, c;
+        mesh.getTriangle(hit.triangle, a, b, c);
+        isTriangleCorrect &= isSameDistance(intersectTriangle(ray, a, b, c), hit.distance);
+    }
+    check(isHitCorrect, "MeshBVH::raycast finds the closest hit");
+    check(isTriangleCorrect, "MeshBVH::raycast reports the hit triangle");
+    check(isOcclusionCorrect, "MeshBVH::isOccluded matches raycast");
+
+    // the same rays in packets, some with inactive lanes
+    bool isPacketCorrect = true;
+    for (std::size_t first = 0; first + RayPacket::SIZE <= rays.size();
+         first += RayPacket::SIZE) {
+        RayPacket packet;
+        for (std::size_t lane = 0; lane < RayPacket::SIZE; ++lane) {
+            packet.set(lane, rays[first + lane]);
+        }
+        const std::uint32_t laneMask = (first / RayPacket::SIZE) % 3 == 0 ? 0b0101 : 0b1111;
+        RayHit hits[RayPacket::SIZE];
+        const auto hitMask = bvh.raycast(packet, laneMask, hits);
+        isPacketCorrect &= (hitMask & ~laneMask) == 0;
+        for (std::size_t lane = 0; lane < RayPacket::SIZE; ++lane) {
+            if (!(laneMask & (1u << lane))) {
+                continue;
+            }
+            const auto expected = expectedDistances[first + lane];
+            const bool isHit = (hitMask & (1u << lane)) != 0;
+            if (isHit != (expected >= 0.f)) {
+                isPacketCorrect = false;
+            } else if (isHit) {
+                isPacketCorrect &= isSameDistance(hits[lane].distance, expected);
+            }
+        }
+    }
+    check(isPacketCorrect, "MeshBVH::raycast with packets finds the closest hits");
+}
+
+void checkMeshQueries(const MeshBVH& bvh, const TriangleMesh& mesh, std::mt19937& rng)
+{
+    const auto bounds = getTriangleBounds(mesh);
+    std::uniform_real_distribution<float> sizeDist(0.1f, 3.f);
+    bool isSphereCorrect = true;
+    bool isBoxCorrect = true;
+    std::vector<std::uint32_t> found;
+    std::vector<int> isFound(mesh.getNumTriangles());
+    for (int i = 0; i < 16; ++i) {
+        const auto center = randomPoint(rng, 10.f);
+        const auto radius = sizeDist(rng);
+        found.clear();
+        bvh.querySphere(center, radius, found);
+        std::fill(isFound.begin(), isFound.end(), 0);
+        for (const auto triangle : found) {
+            ++isFound[triangle];
+        }
+        for (std::size_t t = 0; t < mesh.getNumTriangles(); ++t) {
+            glm::vec3 a, b, c;
+            mesh.getTriangle(t, a, b, c);
+            const auto distanceSq = distanceSqToTriangle(center, a, b, c);
+            isSphereCorrect &= isFound[t] <= 1;
+            if (!isNearSphereSurface(distanceSq, radius)) {
+                isSphereCorrect &= (isFound[t] == 1) == (distanceSq <= radius * radius);
+            }
+        }
+
+        const glm::vec3 halfSize{sizeDist(rng), sizeDist(rng), sizeDist(rng)};
+        const AABB box{.min = center - halfSize, .max = center + halfSize};
+        found.clear();
+        bvh.queryAABB(box, found);
+        std::sort(found.begin(), found.end());
+        std::vector<std::uint32_t> expected;
+        for (std::size_t t = 0; t < bounds.size(); ++t) {
+            if (box.overlaps(bounds[t])) {
+                expected.push_back(static_cast<std::uint32_t>(t));
+            }
+        }
+        isBoxCorrect &= found == expected;
+    }
+    check(isSphereCorrect, "MeshBVH::querySphere finds the touched triangles");
+    check(isBoxCorrect, "MeshBVH::queryAABB finds the overlapping triangles");
+}
+
+void checkMesh(std::size_t numTriangles, util::TaskScheduler* scheduler)
+{
+    std::mt19937 rng(static_cast<std::uint32_t>(numTriangles));
+    const auto mesh = makeTriangleSoup(numTriangles, 10.f, rng);
+
+    BVH bvh;
+    const auto bounds = getTriangleBounds(mesh);
+    bvh.build(bounds, scheduler);
+    checkStructure(bvh, bounds);
+
+    MeshBVH meshBVH;
+    meshBVH.build(mesh.positions, mesh.indices, scheduler);
+    check(meshBVH.getNumTriangles() == numTriangles, "MeshBVH has all triangles");
+    checkMeshRaycasts(meshBVH, mesh, makeRays(64, 10.f, rng));
+    checkMeshQueries(meshBVH, mesh, rng);
+}
+
+void checkScene(util::TaskScheduler* scheduler)
+{
+    std::mt19937 rng(42);
+    const auto mesh = makeTriangleSoup(2000, 2.f, rng);
+    MeshBVH meshBVH;
+    meshBVH.build(mesh.positions, mesh.indices, scheduler);
+
+    std::uniform_real_distribution<float> angleDist(0.f, 6.28f);
+    std::uniform_real_distribution<float> scaleDist(0.5f, 2.f);
+    std::vector<SceneBVH::Instance> instances;
+    for (int i = 0; i < 24; ++i) {
+        auto transform = glm::translate(glm::mat4{1.f}, randomPoint(rng, 10.f));
+        transform = glm::rotate(transform, angleDist(rng), glm::normalize(randomPoint(rng, 1.f)));
+        transform = glm::scale(transform, glm::vec3{scaleDist(rng)});
+        instances.push_back(SceneBVH::Instance{.mesh = &meshBVH, .transform = transform});
+    }
+    SceneBVH scene;
+    scene.build(instances, scheduler);
+
+    // brute force in the instances' local space, like SceneBVH does
+    const auto toLocal = [](const glm::mat4& inverse, const Ray& ray) {
+        return Ray{
+            .origin = glm::vec3{inverse * glm::vec4{ray.origin, 1.f}},
+            .direction = glm::vec3{inverse * glm::vec4{ray.direction, 0.f}},
+            .maxDistance = ray.maxDistance,
+        };
+    };
+
+    std::vector<glm::mat4> inverseTransforms;
+    for (const auto& instance : instances) {
+        inverseTransforms.push_back(glm::inverse(instance.transform));
+    }
+
+    bool isHitCorrect = true;
+    for (const auto& ray : makeRays(64, 10.f, rng)) {
+        float expected = -1.f;
+        for (const auto& inverse : inverseTransforms) {
+            const auto t = raycastBruteForce(mesh, toLocal(inverse, ray));
+            if (t >= 0.f && (expected < 0.f || t < expected)) {
+                expected = t;
+            }
+        }
+        RayHit hit;
+        const auto found = scene.raycast(ray, hit);
+        isHitCorrect &= scene.isOccluded(ray) == (expected >= 0.f);
+        if (found != (expected >= 0.f)) {
+            isHitCorrect = false;
+        } else if (found) {
+            isHitCorrect &= isSameDistance(hit.distance, expected);
+            isHitCorrect &= hit.instance < instances.size();
+        }
+    }
+    check(isHitCorrect, "SceneBVH::raycast finds the closest hit");
+
+    bool isSphereCorrect = true;
+    bool isBoxCorrect = true;
+    std::vector<SceneBVH::TriangleRef> found;
+    for (int i = 0; i < 16; ++i) {
+        const auto center = randomPoint(rng, 10.f);
+        const auto radius = scaleDist(rng);
+        found.clear();
+        scene.querySphere(center, radius, found);
+
+        const glm::vec3 halfSize{radius};
+        const AABB box{.min = center - halfSize, .max = center + halfSize};
+        std::vector<SceneBVH::TriangleRef> foundInBox;
+        scene.queryAABB(box, foundInBox);
+
+        // how many times each triangle of each instance was found
+        const auto numTriangles = mesh.getNumTriangles();
+        const auto countRefs = [&](const std::vector<SceneBVH::TriangleRef>& refs) {
+            std::vector<int> counts(instances.size() * numTriangles, 0);
+            for (const auto& ref : refs) {
+                ++counts[ref.instance * numTriangles + ref.triangle];
+            }
+            return counts;
+        };
+        const auto sphereCounts = countRefs(found);
+        const auto boxCounts = countRefs(foundInBox);
+
+        for (std::size_t inst = 0; inst < instances.size(); ++inst) {
+            const auto& transform = instances[inst].transform;
+            for (std::size_t t = 0; t < numTriangles; ++t) {
+                glm::vec3 v[3];
+                mesh.getTriangle(t, v[0], v[1], v[2]);
+                for (auto& p : v) {
+                    p = glm::vec3{transform * glm::vec4{p, 1.f}};
+                }
+
+                const auto numFound = sphereCounts[inst * numTriangles + t];
+                isSphereCorrect &= numFound <= 1;
+                const auto distanceSq = distanceSqToTriangle(center, v[0], v[1], v[2]);
+                if (!isNearSphereSurface(distanceSq, radius)) {
+                    isSphereCorrect &= (numFound == 1) == (distanceSq <= radius * radius);
+                }
+
+                // queryAABB is conservative, so only check that triangles with a vertex
+                // in the box aren't missed
+                const auto isInBox = std::any_of(std::begin(v), std::end(v), [&](const auto& p) {
+                    return box.overlaps(AABB{.min = p, .max = p});
+                });
+                const auto numFoundInBox = boxCounts[inst * numTriangles + t];
+                isBoxCorrect &= isInBox ? numFoundInBox == 1 : numFoundInBox <= 1;
+            }
+        }
+    }
+    check(isSphereCorrect, "SceneBVH::querySphere finds the touched triangles");
+    check(isBoxCorrect, "SceneBVH::queryAABB finds the overlapping triangles");
+}
+
+void runChecks(util::TaskScheduler* scheduler)
+{
+    checkMesh(1, scheduler);
+    checkMesh(100, scheduler);
+    // above the subtree size and the parallel binning threshold of BVH::build
+    checkMesh(70000, scheduler);
+    checkScene(scheduler);
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    runChecks(nullptr);
+    util::TaskScheduler scheduler(2);
+    runChecks(&scheduler);
+
+    if (numFailures != 0) {
+        printf("%d check(s) failed\n", numFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
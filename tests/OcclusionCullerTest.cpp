@@ -0,0 +1,102 @@
+// Headless checks of OcclusionCuller: visibility of boxes around a known occluder
+// and the max-depth hierarchy. Returns a non-zero exit code if any check fails.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <Graphics/OcclusionCuller.h>
+#include <util/TaskScheduler.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+int numFailures = 0;
+
+void check(bool condition, const char* what)
+{
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        ++numFailures;
+    }
+}
+
+// level texels have to be the farthest depth of level 0 texels they cover
+void checkHierarchy(const OcclusionCuller& culler)
+{
+    const auto width = culler.getWidth(0);
+    const auto height = culler.getHeight(0);
+    for (int l = 1; l < static_cast<int>(culler.getNumLevels()); ++l) {
+        for (int y = 0; y < culler.getHeight(l); ++y) {
+            for (int x = 0; x < culler.getWidth(l); ++x) {
+                float expected = 0.f;
+                for (int y0 = y << l; y0 < std::min((y + 1) << l, height); ++y0) {
+                    for (int x0 = x << l; x0 < std::min((x + 1) << l, width); ++x0) {
+                        expected = std::max(expected, culler.getDepth(0, x0, y0));
+                    }
+                }
+                if (culler.getDepth(l, x, y) != expected) {
+                    printf("level %d, texel (%d, %d): ", l, x, y);
+                    check(false, "hierarchy matches level 0");
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void runChecks(util::TaskScheduler* scheduler)
+{
+    // the camera is at the origin looking down -Z, so there's no view transform
+    const auto proj = glm::perspective(glm::radians(90.f), 4.f / 3.f, 0.1f, 100.f);
+
+    // 4x4 quad facing the camera at distance 5, covers the middle of the screen
+    const std::vector<glm::vec3> positions{
+        {-2.f, -2.f, -5.f},
+        {2.f, -2.f, -5.f},
+        {2.f, 2.f, -5.f},
+        {-2.f, 2.f, -5.f},
+    };
+    const std::vector<std::uint16_t> indices{0, 1, 2, 0, 2, 3};
+
+    OcclusionCuller culler;
+    culler.beginFrame(proj);
+    culler.addOccluder(positions, indices, glm::mat4{1.f});
+    culler.rasterize(scheduler);
+    check(culler.getNumOccluderTriangles() == 2, "both occluder triangles are rasterized");
+
+    const glm::mat4 model{1.f};
+    check(
+        !culler.isVisible({-1.f, -1.f, -9.f}, {1.f, 1.f, -7.f}, model),
+        "box fully behind the occluder is hidden");
+    check(
+        culler.isVisible({1.5f, -1.f, -9.f}, {4.f, 1.f, -7.f}, model),
+        "box partly behind the occluder is visible");
+    check(
+        culler.isVisible({-1.f, -1.f, -3.f}, {1.f, 1.f, -2.f}, model),
+        "box in front of the occluder is visible");
+    check(
+        culler.isVisible({-0.5f, -0.5f, -6.f}, {0.5f, 0.5f, 1.f}, model),
+        "box crossing the near plane is visible");
+
+    checkHierarchy(culler);
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    runChecks(nullptr);
+    // bands and triangle setup are split between workers
+    util::TaskScheduler scheduler(2);
+    runChecks(&scheduler);
+
+    if (numFailures != 0) {
+        printf("%d check(s) failed\n", numFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
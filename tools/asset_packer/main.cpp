@@ -0,0 +1,259 @@
+// Packs a directory into a single asset pack (see util/AssetPackFormat.h)
+// Usage: asset_packer <output> <input dir> <name prefix> [--stream-dir <dir> <files>...]
+// Files listed after --stream-dir (relative to the input dir) are not packed, but
+// written to <dir> after the same conversions, so that the game can stream them.
+// .gltf files are converted to cooked models (see util/CookedModel.h).
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Graphics/ModelData.h>
+#include <util/AssetPackFormat.h>
+#include <util/CookedModel.h>
+#include <util/GltfLoader.h>
+#include <util/LZ4.h>
+
+// the implementation is in GltfLoader.cpp
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#include <tiny_gltf.h>
+
+namespace
+{
+// only store compressed data if it saves at least 10%
+constexpr double MAX_COMPRESSION_RATIO = 0.9;
+
+struct InputFile {
+    std::filesystem::path path;
+    std::filesystem::path relativePath;
+    std::string name;
+    std::vector<std::uint8_t> data;
+    std::vector<std::uint8_t> storedData;
+    AssetPackCompression compression{AssetPackCompression::None};
+};
+
+bool readFile(const std::filesystem::path& path, std::vector<std::uint8_t>& data)
+{
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) {
+        return false;
+    }
+    data.resize(static_cast<std::size_t>(f.tellg()));
+    f.seekg(0);
+    f.read(reinterpret_cast<char*>(data.data()), data.size());
+    return static_cast<bool>(f);
+}
+
+bool skipImageLoading(
+    tinygltf::Image* image,
+    const int image_idx,
+    std::string* err,
+    std::string* warn,
+    int req_width,
+    int req_height,
+    const unsigned char* bytes,
+    int size,
+    void*)
+{
+    return true;
+};
+
+// Buffers are baked into cooked models, so they don't need to be stored separately
+bool findExternalBuffers(
+    const std::filesystem::path& path,
+    std::vector<std::filesystem::path>& bufferPaths)
+{
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(skipImageLoading, nullptr);
+
+    tinygltf::Model model;
+    std::string err;
+    std::string warn;
+    if (!loader.LoadASCIIFromFile(&model, &err, &warn, path.string())) {
+        printf("Failed to load '%s': %s\n", path.string().c_str(), err.c_str());
+        return false;
+    }
+
+    for (const auto& buffer : model.buffers) {
+        if (!buffer.uri.empty() && buffer.uri.rfind("data:", 0) != 0) {
+            bufferPaths.push_back((path.parent_path() / buffer.uri).lexically_normal());
+        }
+    }
+    return true;
+}
+
+bool cookModel(
+    const std::filesystem::path& path,
+    std::vector<std::uint8_t>& data,
+    std::vector<std::filesystem::path>& embeddedBuffers)
+{
+    std::vector<std::uint8_t> gltfData;
+    if (!readFile(path, gltfData) || !findExternalBuffers(path, embeddedBuffers)) {
+        return false;
+    }
+
+    const auto model = util::loadGltfModel(path, gltfData);
+    if (model.meshes.empty()) {
+        return false; // the loader has logged the error
+    }
+    data = util::writeCookedModel(model);
+    return true;
+}
+
+bool writeFile(const std::filesystem::path& path, const std::vector<std::uint8_t>& data)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream f(path, std::ios::binary);
+    f.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(f);
+}
+
+std::uint64_t alignUp(std::uint64_t offset)
+{
+    return (offset + ASSET_PACK_ALIGNMENT - 1) & ~(ASSET_PACK_ALIGNMENT - 1);
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* args[])
+{
+    const bool hasStreamDir = argc > 5 && std::string{args[4]} == "--stream-dir";
+    if (argc < 4 || (argc > 4 && !hasStreamDir)) {
+        printf(
+            "Usage: %s <output> <input dir> <name prefix> [--stream-dir <dir> <files>...]\n",
+            args[0]);
+        return 1;
+    }
+
+    const std::filesystem::path outputPath{args[1]};
+    const std::filesystem::path inputDir{args[2]};
+    const std::filesystem::path prefix{args[3]};
+
+    std::filesystem::path streamDir;
+    std::vector<std::filesystem::path> streamedFiles;
+    if (hasStreamDir) {
+        streamDir = args[5];
+        for (int i = 6; i < argc; ++i) {
+            streamedFiles.push_back(std::filesystem::path{args[i]}.lexically_normal());
+        }
+    }
+
+    std::vector<InputFile> files;
+    std::vector<std::filesystem::path> embeddedBuffers;
+    for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(inputDir)) {
+        if (!dirEntry.is_regular_file()) {
+            continue;
+        }
+
+        InputFile file;
+        file.path = dirEntry.path().lexically_normal();
+        file.relativePath = dirEntry.path().lexically_relative(inputDir);
+        // keep .gltf names for cooked models so that the game code doesn't change
+        file.name = (prefix / file.relativePath).generic_string();
+        const bool ok = dirEntry.path().extension() == ".gltf" ?
+                            cookModel(dirEntry.path(), file.data, embeddedBuffers) :
+                            readFile(dirEntry.path(), file.data);
+        if (!ok) {
+            printf("Failed to read '%s'\n", dirEntry.path().string().c_str());
+            return 1;
+        }
+
+        if (std::find(streamedFiles.begin(), streamedFiles.end(), file.relativePath) !=
+            streamedFiles.end()) {
+            if (!writeFile(streamDir / file.relativePath, file.data)) {
+                printf("Failed to write '%s'\n", (streamDir / file.relativePath).string().c_str());
+                return 1;
+            }
+            continue;
+        }
+
+        auto compressed = util::compressLZ4(file.data);
+        if (compressed.size() < file.data.size() * MAX_COMPRESSION_RATIO) {
+            file.storedData = std::move(compressed);
+            file.compression = AssetPackCompression::LZ4;
+        } else {
+            file.storedData = file.data;
+        }
+        files.push_back(std::move(file));
+    }
+
+    // buffers are baked into cooked models, no need to store them separately
+    std::erase_if(files, [&embeddedBuffers](const InputFile& file) {
+        return std::find(embeddedBuffers.begin(), embeddedBuffers.end(), file.path) !=
+               embeddedBuffers.end();
+    });
+
+    // the game does a binary search by name
+    std::sort(files.begin(), files.end(), [](const InputFile& a, const InputFile& b) {
+        return a.name < b.name;
+    });
+
+    std::string names;
+    std::vector<AssetPackEntry> entries;
+    for (const auto& file : files) {
+        entries.push_back(AssetPackEntry{
+            .offset = 0,
+            .storedSize = file.storedData.size(),
+            .size = file.data.size(),
+            .nameOffset = static_cast<std::uint32_t>(names.size()),
+            .nameLength = static_cast<std::uint32_t>(file.name.size()),
+            .compression = file.compression,
+            .padding = 0,
+        });
+        names += file.name;
+    }
+
+    const AssetPackHeader header{
+        .magic = ASSET_PACK_MAGIC,
+        .version = ASSET_PACK_VERSION,
+        .numEntries = static_cast<std::uint32_t>(entries.size()),
+        .namesSize = static_cast<std::uint32_t>(names.size()),
+    };
+
+    std::uint64_t offset = sizeof(header) + entries.size() * sizeof(AssetPackEntry) + names.size();
+    for (auto& entry : entries) {
+        offset = alignUp(offset);
+        entry.offset = offset;
+        offset += entry.storedSize;
+    }
+
+    std::ofstream out(outputPath, std::ios::binary);
+    if (!out) {
+        printf("Failed to open '%s' for writing\n", outputPath.string().c_str());
+        return 1;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetPackEntry));
+    out.write(names.data(), names.size());
+
+    std::uint64_t totalSize = 0;
+    std::uint64_t totalStoredSize = 0;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        const auto pos = static_cast<std::uint64_t>(out.tellp());
+        const std::vector<char> padding(entries[i].offset - pos, 0);
+        out.write(padding.data(), padding.size());
+        out.write(
+            reinterpret_cast<const char*>(files[i].storedData.data()), files[i].storedData.size());
+
+        totalSize += entries[i].size;
+        totalStoredSize += entries[i].storedSize;
+    }
+
+    if (!out) {
+        printf("Failed to write '%s'\n", outputPath.string().c_str());
+        return 1;
+    }
+
+    printf(
+        "Packed %zu files into '%s' (%llu -> %llu bytes)\n",
+        files.size(),
+        outputPath.string().c_str(),
+        static_cast<unsigned long long>(totalSize),
+        static_cast<unsigned long long>(totalStoredSize));
+    return 0;
+}
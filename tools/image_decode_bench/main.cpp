@@ -0,0 +1,205 @@
+// Measures throughput of the game's image decode pipeline (util/ImageLoader.h).
+// Usage: image_decode_bench [--iterations <n>] [--workers <n>] <images>...
+// Reports MB/s of decoded pixels (and of compressed input for decoding) for serial
+// and parallel decoding and for each in-place conversion. Tools are only built natively,
+// so these are native numbers, not the web build's.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <util/ImageLoader.h>
+#include <util/TaskScheduler.h>
+
+namespace
+{
+struct InputFile {
+    std::filesystem::path path;
+    std::vector<std::uint8_t> data;
+};
+
+bool readFile(const std::filesystem::path& path, std::vector<std::uint8_t>& data)
+{
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) {
+        return false;
+    }
+    data.resize(static_cast<std::size_t>(f.tellg()));
+    f.seekg(0);
+    f.read(reinterpret_cast<char*>(data.data()), data.size());
+    return static_cast<bool>(f);
+}
+
+// runs f iterations times and prints the throughput for the given number of bytes per run
+void measure(
+    const char* name,
+    int iterations,
+    std::size_t inputSize,
+    std::size_t outputSize,
+    const std::function<void()>& f)
+{
+    f(); // warm-up (page faults, lookup tables)
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f();
+    }
+    const auto seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto toMBs = [&](std::size_t size) {
+        return static_cast<double>(size) * iterations / seconds / 1e6;
+    };
+    if (inputSize != 0) {
+        printf(
+            "%-32s %9.1f MB/s out %9.1f MB/s in %9.3f ms\n",
+            name,
+            toMBs(outputSize),
+            toMBs(inputSize),
+            seconds * 1000.0 / iterations);
+    } else {
+        printf(
+            "%-32s %9.1f MB/s out %16s %9.3f ms\n",
+            name,
+            toMBs(outputSize),
+            "",
+            seconds * 1000.0 / iterations);
+    }
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* args[])
+{
+    int iterations = 10;
+    std::size_t numWorkers = util::TaskScheduler::getDefaultWorkerCount();
+    std::vector<InputFile> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(args[++i]));
+        } else if (std::strcmp(args[i], "--workers") == 0 && i + 1 < argc) {
+            numWorkers = static_cast<std::size_t>(std::max(0, std::atoi(args[++i])));
+        } else {
+            InputFile file{.path = args[i], .data = {}};
+            if (!readFile(file.path, file.data)) {
+                printf("Failed to read '%s'\n", args[i]);
+                return 1;
+            }
+            files.push_back(std::move(file));
+        }
+    }
+    if (files.empty()) {
+        printf("Usage: %s [--iterations <n>] [--workers <n>] <images>...\n", args[0]);
+        return 1;
+    }
+
+    // decode once to get sizes and images for conversion benchmarks
+    const util::ImageLoadParams rgba{.flip = false};
+    std::size_t inputSize = 0;
+    std::size_t outputSize = 0;
+    std::vector<ImageData> images;
+    for (const auto& file : files) {
+        auto image = util::decodeImage(file.data, rgba);
+        if (!image.pixels && !image.hdrPixels) {
+            printf("Failed to decode '%s'\n", file.path.string().c_str());
+            return 1;
+        }
+        printf(
+            "%s: %dx%d, %d channels%s\n",
+            file.path.string().c_str(),
+            image.width,
+            image.height,
+            image.comp,
+            image.hdr ? " (HDR)" : "");
+        inputSize += file.data.size();
+        outputSize += image.getSize();
+        images.push_back(std::move(image));
+    }
+    printf("%zu images, %d iterations, %zu workers\n\n", files.size(), iterations, numWorkers);
+
+    measure("decode", iterations, inputSize, outputSize, [&]() {
+        for (const auto& file : files) {
+            util::decodeImage(file.data, rgba);
+        }
+    });
+    measure("decode + flip", iterations, inputSize, outputSize, [&]() {
+        for (const auto& file : files) {
+            util::decodeImage(file.data, {.flip = true});
+        }
+    });
+    measure("decode + flip + premultiply", iterations, inputSize, outputSize, [&]() {
+        for (const auto& file : files) {
+            util::decodeImage(file.data, {.flip = true, .premultiplyAlpha = true});
+        }
+    });
+
+    // every image is a separate task, so repeat the set to give workers enough work
+    util::TaskScheduler scheduler(numWorkers);
+    static constexpr int batchCopies = 8;
+    const auto batchInputSize = inputSize * batchCopies;
+    const auto batchOutputSize = outputSize * batchCopies;
+    measure("decode, batched", iterations, batchInputSize, batchOutputSize, [&]() {
+        const auto n = files.size() * batchCopies;
+        scheduler.parallelFor(n, 1, [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                util::decodeImage(files[i % files.size()].data, rgba);
+            }
+        });
+    });
+    std::vector<std::filesystem::path> paths;
+    for (int i = 0; i < batchCopies; ++i) {
+        for (const auto& file : files) {
+            paths.push_back(file.path);
+        }
+    }
+    measure("loadImages", iterations, batchInputSize, batchOutputSize, [&]() {
+        util::loadImages(paths, rgba, scheduler);
+    });
+
+    // conversions, on 8-bit images only
+    printf("\n");
+    std::size_t ldrSize = 0;
+    for (const auto& image : images) {
+        if (image.pixels) {
+            ldrSize += image.getSize();
+        }
+    }
+    if (ldrSize == 0) {
+        return 0;
+    }
+    std::vector<float> linear;
+    const auto forEachLDR = [&images](const auto& f) {
+        for (auto& image : images) {
+            if (image.pixels) {
+                f(image, static_cast<std::size_t>(image.width) * image.height);
+            }
+        }
+    };
+    measure("flip", iterations, 0, ldrSize, [&]() {
+        forEachLDR([](ImageData& image, std::size_t) {
+            util::flipImageVertically(image.pixels, image.width * image.channels, image.height);
+        });
+    });
+    // premultiplying repeatedly makes alpha-weighted colors darker, but costs the same
+    measure("premultiply (linear)", iterations, 0, ldrSize, [&]() {
+        forEachLDR([](ImageData& image, std::size_t numPixels) {
+            util::premultiplyAlpha(image.pixels, numPixels, image.channels, false);
+        });
+    });
+    measure("premultiply (sRGB)", iterations, 0, ldrSize, [&]() {
+        forEachLDR([](ImageData& image, std::size_t numPixels) {
+            util::premultiplyAlpha(image.pixels, numPixels, image.channels, true);
+        });
+    });
+    measure("sRGB to linear", iterations, 0, ldrSize * sizeof(float), [&]() {
+        forEachLDR([&linear](ImageData& image, std::size_t numPixels) {
+            linear.resize(numPixels * image.channels);
+            util::srgbToLinear(image.pixels, linear.data(), numPixels, image.channels);
+        });
+    });
+}
@@ -0,0 +1,262 @@
+// Prints sizes of wasm sections and how much code each module contributes.
+// Usage: wasm_size_report <file.wasm>
+// Function names are taken from the "name" section, so the binary should be
+// linked with --profiling-funcs (otherwise all code is reported as unnamed).
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+struct Module {
+    const char* name;
+    std::vector<std::string_view> patterns; // matched against qualified function names
+    // patterns are prefixes of names without a namespace (C functions)
+    bool isC{false};
+};
+
+// first match wins, so more specific modules go first
+const std::vector<Module> modules = {
+    {"tinygltf", {"tinygltf", "nlohmann"}},
+    {"imgui", {"ImGui", "ImDraw", "ImFont", "stbtt", "stbrp", "stb_text"}},
+    {"stb_image", {"stbi"}},
+    {"SDL", {"SDL"}},
+    {"std::regex", {"regex"}},
+    {"libc++", {"std::", "__cxa", "__cxx"}},
+    {"libc",
+     {"printf",
+      "fprintf",
+      "sprintf",
+      "snprintf",
+      "vfprintf",
+      "vsnprintf",
+      "malloc",
+      "calloc",
+      "realloc",
+      "free",
+      "mem",
+      "str",
+      "__"},
+     true},
+};
+
+const char* sectionNames[] = {
+    "custom",
+    "type",
+    "import",
+    "function",
+    "table",
+    "memory",
+    "global",
+    "export",
+    "start",
+    "element",
+    "code",
+    "data",
+    "datacount",
+    "tag",
+};
+
+class Reader {
+public:
+    Reader(const std::uint8_t* begin, const std::uint8_t* end) : ptr(begin), end(end) {}
+
+    bool atEnd() const { return ptr >= end; }
+    const std::uint8_t* pos() const { return ptr; }
+
+    std::uint8_t byte() { return ptr < end ? *ptr++ : 0; }
+
+    std::uint32_t leb()
+    {
+        std::uint32_t result = 0;
+        for (int shift = 0; shift < 35 && ptr < end; shift += 7) {
+            const auto b = *ptr++;
+            result |= static_cast<std::uint32_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    std::string_view string()
+    {
+        const auto len = std::min<std::size_t>(leb(), end - ptr);
+        std::string_view s{reinterpret_cast<const char*>(ptr), len};
+        ptr += len;
+        return s;
+    }
+
+    void skip(std::size_t n) { ptr += std::min<std::size_t>(n, end - ptr); }
+
+    void limits()
+    {
+        const auto flags = byte();
+        leb();
+        if (flags & 1) {
+            leb();
+        }
+    }
+
+private:
+    const std::uint8_t* ptr;
+    const std::uint8_t* end;
+};
+
+std::uint32_t countImportedFunctions(Reader r)
+{
+    std::uint32_t numFunctions = 0;
+    const auto count = r.leb();
+    for (std::uint32_t i = 0; i < count; ++i) {
+        r.string(); // module
+        r.string(); // field
+        switch (r.byte()) {
+        case 0: // function
+            r.leb();
+            ++numFunctions;
+            break;
+        case 1: // table
+            r.byte();
+            r.limits();
+            break;
+        case 2: // memory
+            r.limits();
+            break;
+        case 3: // global
+            r.byte();
+            r.byte();
+            break;
+        case 4: // tag
+            r.byte();
+            r.leb();
+            break;
+        }
+    }
+    return numFunctions;
+}
+
+void readFunctionNames(Reader r, std::unordered_map<std::uint32_t, std::string_view>& names)
+{
+    while (!r.atEnd()) {
+        const auto id = r.byte();
+        const auto size = r.leb();
+        if (id != 1) { // function names
+            r.skip(size);
+            continue;
+        }
+        const auto count = r.leb();
+        for (std::uint32_t i = 0; i < count; ++i) {
+            const auto index = r.leb();
+            names[index] = r.string();
+        }
+        return;
+    }
+}
+
+const char* getModuleName(std::string_view functionName)
+{
+    if (functionName.empty()) {
+        return "(unnamed)";
+    }
+    // names are demangled, don't look at parameter types and template arguments
+    functionName = functionName.substr(0, functionName.find_first_of("(<"));
+    const bool isQualified = functionName.find("::") != std::string_view::npos;
+    for (const auto& module : modules) {
+        if (module.isC && isQualified) {
+            continue;
+        }
+        for (const auto& pattern : module.patterns) {
+            const auto pos = functionName.find(pattern);
+            if (module.isC ? pos == 0 : pos != std::string_view::npos) {
+                return module.name;
+            }
+        }
+    }
+    return "game";
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* args[])
+{
+    if (argc < 2) {
+        printf("Usage: %s <file.wasm>\n", args[0]);
+        return 1;
+    }
+
+    std::ifstream f(args[1], std::ios::binary);
+    const std::vector<std::uint8_t> wasm{std::istreambuf_iterator<char>(f), {}};
+    if (wasm.size() < 8 || std::string_view(reinterpret_cast<const char*>(wasm.data()), 4) !=
+                               std::string_view("\0asm", 4)) {
+        printf("'%s' is not a wasm file\n", args[1]);
+        return 1;
+    }
+
+    std::uint32_t numImportedFunctions = 0;
+    std::vector<std::uint32_t> functionSizes;
+    std::unordered_map<std::uint32_t, std::string_view> functionNames;
+
+    printf("%-24s %10s\n", "section", "bytes");
+    Reader r(wasm.data() + 8, wasm.data() + wasm.size());
+    while (!r.atEnd()) {
+        const auto id = r.byte();
+        const auto size = r.leb();
+        Reader section(r.pos(), r.pos() + size);
+
+        std::string name = id < std::size(sectionNames) ? sectionNames[id] : "unknown";
+        if (id == 0) {
+            const auto customName = section.string();
+            name += " (" + std::string(customName) + ")";
+            if (customName == "name") {
+                readFunctionNames(section, functionNames);
+            }
+        } else if (id == 2) {
+            numImportedFunctions = countImportedFunctions(section);
+        } else if (id == 10) {
+            const auto count = section.leb();
+            for (std::uint32_t i = 0; i < count; ++i) {
+                const auto bodySize = section.leb();
+                functionSizes.push_back(bodySize);
+                section.skip(bodySize);
+            }
+        }
+
+        printf("%-24s %10u\n", name.c_str(), size);
+        r.skip(size);
+    }
+    printf("%-24s %10zu\n\n", "total", wasm.size());
+
+    // code size per module
+    std::unordered_map<std::string_view, std::uint64_t> moduleSizes;
+    std::uint64_t totalCodeSize = 0;
+    for (std::size_t i = 0; i < functionSizes.size(); ++i) {
+        const auto it = functionNames.find(static_cast<std::uint32_t>(i + numImportedFunctions));
+        const auto name = it != functionNames.end() ? it->second : std::string_view{};
+        moduleSizes[getModuleName(name)] += functionSizes[i];
+        totalCodeSize += functionSizes[i];
+    }
+
+    std::vector<std::pair<std::string_view, std::uint64_t>> sorted(
+        moduleSizes.begin(), moduleSizes.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second > b.second;
+    });
+
+    printf("%-24s %10s %6s\n", "module (code)", "bytes", "%");
+    for (const auto& [name, size] : sorted) {
+        printf(
+            "%-24.*s %10llu %5.1f%%\n",
+            static_cast<int>(name.size()),
+            name.data(),
+            static_cast<unsigned long long>(size),
+            totalCodeSize ? 100.0 * size / totalCodeSize : 0.0);
+    }
+    return 0;
+}